@@ -0,0 +1,80 @@
+// applier_pool.cpp
+#include "applier_pool.hpp"
+#include <algorithm>
+#include "clock.hpp"
+
+ApplierPool::ApplierPool(size_t count, size_t capacity, BatchFn apply)
+    : queue(capacity), apply(std::move(apply)) {
+    for (size_t i = 0; i < count; i++) {
+        threads.emplace_back(&ApplierPool::run, this);
+    }
+}
+
+ApplierPool::~ApplierPool() {
+    {
+        std::lock_guard<std::mutex> lock(park_mutex);
+        stopping = true;
+    }
+    park_cv.notify_all();
+    for (auto &t : threads) t.join();
+}
+
+bool ApplierPool::submit(const HeartbeatEvent &event) {
+    if (!queue.tryPush(event)) {
+        overflows.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    // Pairs with the fence in run(): either we see the applier parked or
+    // it sees the event. Taking the lock means it is already waiting, or
+    // will check the queue after we release it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (parked.load(std::memory_order_relaxed) > 0) {
+        { std::lock_guard<std::mutex> lock(park_mutex); }
+        park_cv.notify_one();
+    }
+    return true;
+}
+
+void ApplierPool::run() {
+    std::vector<HeartbeatEvent> batch(MAX_BATCH);
+
+    while (true) {
+        size_t n = 0;
+        while (n < MAX_BATCH && queue.tryPop(batch[n])) n++;
+
+        if (n == 0) {
+            if (stopping) break; // only once the queue is drained
+            std::unique_lock<std::mutex> lock(park_mutex);
+            parked++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            park_cv.wait(lock, [this] { return stopping || queue.depth() > 0; });
+            parked--;
+            continue;
+        }
+
+        apply(batch.data(), n);
+
+        // Account latency once per batch: the oldest event bounds the rest
+        int64_t latency = std::max<int64_t>(0, LivenessClock::read() - batch[0].received_ns);
+        batches.fetch_add(1, std::memory_order_relaxed);
+        events.fetch_add(n, std::memory_order_relaxed);
+        latency_sum_ns.fetch_add(latency, std::memory_order_relaxed);
+        latency_count.fetch_add(1, std::memory_order_relaxed);
+        uint64_t prev = latency_max_ns.load(std::memory_order_relaxed);
+        while ((uint64_t)latency > prev &&
+               !latency_max_ns.compare_exchange_weak(prev, latency, std::memory_order_relaxed)) {}
+    }
+}
+
+ApplierStats ApplierPool::stats() {
+    ApplierStats s{};
+    s.queue_depth = queue.depth();
+    s.batches = batches.load(std::memory_order_relaxed);
+    s.events = events.load(std::memory_order_relaxed);
+    s.overflows = overflows.load(std::memory_order_relaxed);
+    uint64_t sum = latency_sum_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t count = latency_count.exchange(0, std::memory_order_relaxed);
+    s.avg_latency_us = count ? sum / count / 1000 : 0;
+    s.max_latency_us = latency_max_ns.exchange(0, std::memory_order_relaxed) / 1000;
+    return s;
+}
@@ -0,0 +1,68 @@
+#ifndef APPLIER_POOL_HPP
+#define APPLIER_POOL_HPP
+
+#include "mpmc_queue.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A heartbeat parsed by a reader thread, waiting to be applied
+struct HeartbeatEvent {
+    uint32_t handle;
+    int64_t received_ns; // cached LivenessClock::now(), for apply-latency accounting
+};
+
+struct ApplierStats {
+    size_t queue_depth;
+    uint64_t batches;
+    uint64_t events;
+    uint64_t overflows;      // submits rejected because the queue was full
+    uint64_t avg_latency_us; // receive -> apply, since the previous stats() call
+    uint64_t max_latency_us;
+};
+
+// Fixed pool of applier threads draining a bounded MPMC queue. Reader
+// threads only parse and submit; each applier pops up to MAX_BATCH events
+// and hands them to the batch function in one call. touch() takes no lock,
+// so this no longer saves locking: what it moves off the readers is the
+// record writes and whatever they trigger (a failed node coming back runs
+// the transition and its listeners). Submitting reads no clock; latency
+// is measured at the liveness clock's resolution (a few ms).
+class ApplierPool {
+public:
+    static const size_t MAX_BATCH = 512;
+
+    using BatchFn = std::function<void(const HeartbeatEvent *events, size_t count)>;
+
+    ApplierPool(size_t threads, size_t capacity, BatchFn apply);
+    ~ApplierPool(); // drains the queue before joining
+
+    // Returns false if the queue is full; the caller should apply the event
+    // itself rather than drop it.
+    bool submit(const HeartbeatEvent &event);
+
+    ApplierStats stats();
+
+private:
+    void run();
+
+    MpmcQueue<HeartbeatEvent> queue;
+    BatchFn apply;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping{false};
+
+    // Idle appliers park here with no timeout; producers only notify when
+    // someone is parked (see submit() for why no wakeup is lost)
+    std::mutex park_mutex;
+    std::condition_variable park_cv;
+    std::atomic<int> parked{0};
+
+    std::atomic<uint64_t> batches{0}, events{0}, overflows{0};
+    std::atomic<uint64_t> latency_sum_ns{0}, latency_count{0}, latency_max_ns{0};
+};
+
+#endif
@@ -0,0 +1,30 @@
+#!/bin/bash
+# ========================================================
+# epoll vs. io_uring manager backends at 50k connections
+# ========================================================
+# Needs `ulimit -n` above the connection count on both sides.
+# Run from the repository root after `make -f MAKEFILE bench`.
+
+CONNECTIONS=${CONNECTIONS:-50000}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-10}
+LOADGEN_THREADS=${LOADGEN_THREADS:-8}
+REACTORS=${REACTORS:-1}
+WORKDIR=$(mktemp -d)
+
+echo "backend,connections,heartbeats_per_sec"
+for BACKEND in epoll uring; do
+    pkill -f "manager primary" 2>/dev/null
+    sleep 1
+    (cd "$WORKDIR" && exec "$OLDPWD/manager" primary --backend $BACKEND --reactors $REACTORS > manager.out 2>&1) &
+    MANAGER_PID=$!
+    sleep 1
+
+    RESULT=$(./bench/loadgen --connections $CONNECTIONS --threads $LOADGEN_THREADS \
+                             --seconds $SECONDS_PER_RUN --sources 4)
+    RATE=$(echo "$RESULT" | sed -n 's/.*rate=\([0-9]*\).*/\1/p')
+    echo "$BACKEND,$CONNECTIONS,$RATE"
+
+    kill -9 $MANAGER_PID 2>/dev/null
+    wait $MANAGER_PID 2>/dev/null
+done
+rm -rf "$WORKDIR"
@@ -0,0 +1,74 @@
+// board_bench.cpp - liveness updates/sec through the shared-memory board
+//
+// Writer threads each claim a slot and store heartbeats into it in a tight
+// loop while one thread scans the board the way the manager's monitor does.
+// Every writer owns its cache line, so the rate should scale with cores
+// until the scanner's reads start pulling lines away from the writers.
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "../heartbeat_board.hpp"
+
+uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int main(int argc, char* argv[]) {
+    int writers = argc > 1 ? atoi(argv[1]) : 4;
+    int seconds = argc > 2 ? atoi(argv[2]) : 5;
+    std::string name = "/board_bench-" + std::to_string(getpid());
+
+    HeartbeatBoard board(name, HeartbeatBoard::DEFAULT_SLOTS);
+    if (!board.ok()) {
+        std::cerr << "Cannot create board " << name << std::endl;
+        return 1;
+    }
+
+    std::atomic<bool> stop{false};
+    std::vector<uint64_t> beats(writers, 0);
+    std::vector<std::thread> threads;
+    for (int w = 0; w < writers; w++) {
+        threads.emplace_back([&, w] {
+            HeartbeatBoard attached(name);
+            BoardSlot *slot = attached.claim("bench-node-" + std::to_string(w));
+            uint64_t n = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                HeartbeatBoard::beat(slot, monotonicNs());
+                n++;
+            }
+            beats[w] = n;
+        });
+    }
+
+    uint64_t scans = 0, observed = 0;
+    std::vector<uint64_t> last(HeartbeatBoard::DEFAULT_SLOTS, 0);
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(seconds);
+    while (std::chrono::steady_clock::now() < end) {
+        board.forEachClaimed([&](uint32_t i, std::string_view, uint64_t, uint64_t beat_ns) {
+            if (beat_ns != last[i]) observed++;
+            last[i] = beat_ns;
+        });
+        scans++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stop = true;
+    for (auto &t : threads) t.join();
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    shm_unlink(name.c_str());
+
+    uint64_t total = 0;
+    for (uint64_t n : beats) total += n;
+    std::cout << "writers=" << writers
+              << " updates=" << (uint64_t)(total / secs) << "/s"
+              << " scans=" << (uint64_t)(scans / secs) << "/s"
+              << " changed slots seen per scan=" << (scans ? observed / scans : 0) << std::endl;
+    return 0;
+}
@@ -0,0 +1,60 @@
+// changes_bench.cpp - cost of finding what changed in a 1M-node table
+//
+// Each round every node heartbeats and `churn` random nodes leave (one
+// that already left does not change again). A consumer then collects the
+// changed records, through changedSince() and by walking the table
+// comparing each record's version with the epoch it last saw.
+#include <iostream>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "../node_table.hpp"
+
+const size_t NODES = 1000000;
+const int ROUNDS = 20;
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+int main() {
+    NodeTable table;
+    std::vector<uint32_t> handles;
+    for (size_t i = 0; i < NODES; i++) {
+        handles.push_back(table.upsert("rack" + std::to_string(i % 512) + "-node" + std::to_string(i), 1,
+                                       NodeStatus::Active));
+    }
+    std::vector<uint32_t> changed;
+    uint64_t epoch = table.changedSince(0, changed);
+    std::cout << NODES << " nodes" << std::endl;
+
+    std::mt19937 rng(1);
+    for (size_t churn : {10, 1000, 100000}) {
+        double tracked_ms = 0, walk_ms = 0;
+        size_t found = 0, walked = 0;
+        for (int r = 0; r < ROUNDS; r++) {
+            int64_t now = 2 + r;
+            table.touchAll(handles.data(), handles.size(), now);
+            for (size_t c = 0; c < churn; c++) table.leave(handles[rng() % NODES], now);
+
+            uint64_t walk_epoch = epoch;
+            auto start = Clock::now();
+            changed.clear();
+            epoch = table.changedSince(epoch, changed);
+            NodeView node;
+            for (uint32_t h : changed) found += table.read(h, node) && node.status == NodeStatus::Left;
+            tracked_ms += msSince(start);
+
+            start = Clock::now();
+            table.forEach([&](const NodeView &v) { walked += v.version >= walk_epoch; });
+            walk_ms += msSince(start);
+        }
+        std::cout << "  " << churn << " changes per round: changedSince " << tracked_ms / ROUNDS
+                  << " ms, full walk " << walk_ms / ROUNDS << " ms (" << found / ROUNDS << " / "
+                  << walked / ROUNDS << " changed records found)" << std::endl;
+    }
+    return 0;
+}
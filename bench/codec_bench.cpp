@@ -0,0 +1,84 @@
+// codec_bench.cpp - text vs. binary heartbeat encode/decode throughput
+//
+// Encodes the same heartbeats in both wire formats, then decodes them from
+// ~4 KB reads the way the manager does: LineFramer + verb match for text,
+// FrameDecoder + type switch for binary.
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../line_framer.hpp"
+#include "../protocol.hpp"
+
+const size_t MESSAGES = 4000000;
+const size_t READ_SIZE = 4000; // uneven, so messages straddle reads
+
+volatile uint64_t sink; // keeps results observable
+
+template <typename Fn>
+double timeIt(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void report(const char *name, double secs) {
+    std::cout << name << ": " << (uint64_t)(MESSAGES / secs) << " msgs/s" << std::endl;
+}
+
+template <typename Fn>
+void feedInReads(const std::string &wire, Fn fn) {
+    for (size_t off = 0; off < wire.size(); off += READ_SIZE) {
+        fn(wire.data() + off, std::min(READ_SIZE, wire.size() - off));
+    }
+}
+
+int main() {
+    const std::string node_id = "rack17-node00042";
+    std::string text_wire, binary_wire;
+    text_wire.reserve(MESSAGES * 32);
+    binary_wire.reserve(MESSAGES * sizeof(Frame));
+
+    report("text   encode", timeIt([&] {
+        for (size_t i = 0; i < MESSAGES; i++) {
+            text_wire += "HEARTBEAT ";
+            text_wire += node_id;
+            text_wire += '\n';
+        }
+    }));
+    report("binary encode", timeIt([&] {
+        for (size_t i = 0; i < MESSAGES; i++) {
+            Frame f = makeFrame(FRAME_HEARTBEAT, 42, i, i * 1000);
+            binary_wire.append((const char *)&f, sizeof(f));
+        }
+    }));
+
+    report("text   decode", timeIt([&] {
+        LineFramer framer;
+        uint64_t hits = 0;
+        feedInReads(text_wire, [&](const char *p, size_t n) {
+            framer.feed(p, n, [&](std::string_view line, size_t verb_len) {
+                if (line.substr(0, verb_len) == "HEARTBEAT") hits += line.size() - verb_len - 1;
+            });
+        });
+        sink = hits;
+    }));
+    report("binary decode", timeIt([&] {
+        FrameDecoder decoder;
+        uint64_t hits = 0;
+        feedInReads(binary_wire, [&](const char *p, size_t n) {
+            decoder.feed(p, n, [&](const Frame &f, const char *) {
+                switch (f.type) {
+                    case FRAME_HEARTBEAT: hits += f.handle; break;
+                    default: break;
+                }
+            });
+        });
+        sink = hits;
+    }));
+
+    std::cout << "wire bytes per heartbeat: text=" << text_wire.size() / MESSAGES
+              << " binary=" << binary_wire.size() / MESSAGES << std::endl;
+    return 0;
+}
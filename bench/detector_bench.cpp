@@ -0,0 +1,89 @@
+// detector_bench.cpp - monitor CPU for failure detection at 1M nodes
+//
+// Simulates a minute of cluster time in FailureDetector::TICK_NS steps.
+// Every node heartbeats every HEARTBEAT_MS (spread evenly over the
+// interval); after KILL_AT_MS, one node in KILL_EVERY goes silent. Only
+// the detection work is timed: the timing wheel's advance() against a
+// full NodeTable::sweep() at the same granularity and at the old 2 s
+// period.
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "../failure_detector.hpp"
+
+const size_t NODES = 1000000;
+const int64_t HEARTBEAT_MS = 2000;
+const int64_t SUSPECT_MS = 5000;
+const int64_t FAIL_MS = 11000;
+const int64_t RUN_MS = 60000;
+const int64_t KILL_AT_MS = 20000;
+const size_t KILL_EVERY = 100;
+const int64_t START_MS = 1000000; // arbitrary liveness clock origin
+const int64_t MS = 1000000;        // in ns
+const int64_t TICK_MS = FailureDetector::TICK_NS / MS;
+
+struct Result {
+    double busy_ms = 0; // time spent detecting
+    size_t transitions = 0;
+    size_t failed = 0;
+};
+
+// Drives the simulated cluster; detect(now) runs every `period_ms`
+template <typename Detect>
+Result simulate(NodeTable &table, const std::vector<uint32_t> &handles, int64_t period_ms, Detect detect) {
+    Result result;
+    const int64_t steps_per_beat = HEARTBEAT_MS / TICK_MS;
+    for (int64_t t = TICK_MS; t <= RUN_MS; t += TICK_MS) {
+        int64_t now = (START_MS + t) * MS;
+        size_t phase = (t / TICK_MS) % steps_per_beat;
+        for (size_t i = phase; i < NODES; i += steps_per_beat) {
+            if (t >= KILL_AT_MS && i % KILL_EVERY == 0) continue;
+            table.touch(handles[i], now);
+        }
+        if (t % period_ms) continue;
+        auto start = std::chrono::steady_clock::now();
+        result.transitions += detect(now);
+        result.busy_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    table.forEach([&result](const NodeView &node) { result.failed += node.status == NodeStatus::Failed; });
+    return result;
+}
+
+void report(const char *name, const Result &r) {
+    std::cout << "  " << name << ": " << r.busy_ms / (RUN_MS / 1000) << " ms CPU per second, "
+              << r.transitions << " transitions, " << r.failed << " failed (expect " << NODES / KILL_EVERY
+              << ")" << std::endl;
+}
+
+void makeCluster(NodeTable &table, std::vector<uint32_t> &handles) {
+    for (size_t i = 0; i < NODES; i++) {
+        handles.push_back(table.upsert("rack" + std::to_string(i % 512) + "-node" + std::to_string(i),
+                                       START_MS * MS, NodeStatus::Active));
+    }
+}
+
+int main() {
+    std::cout << NODES << " nodes, heartbeat every " << HEARTBEAT_MS << " ms, "
+              << NODES / KILL_EVERY << " go silent at " << KILL_AT_MS / 1000 << " s" << std::endl;
+    {
+        NodeTable table;
+        std::vector<uint32_t> handles;
+        makeCluster(table, handles);
+        FailureDetector detector(table, SUSPECT_MS * MS, FAIL_MS * MS, START_MS * MS);
+        Result r = simulate(table, handles, TICK_MS, [&detector](int64_t now) { return detector.advance(now); });
+        report("timing wheel, 50 ms ticks", r);
+        DetectorStats s = detector.stats();
+        std::cout << "    " << s.scans << " block scans, " << s.armed << " blocks armed at the end" << std::endl;
+    }
+    for (int64_t period : {TICK_MS, (int64_t)2000}) {
+        NodeTable table;
+        std::vector<uint32_t> handles;
+        makeCluster(table, handles);
+        Result r = simulate(table, handles, period, [&table](int64_t now) {
+            return table.sweep(now - SUSPECT_MS * MS, now - FAIL_MS * MS, now);
+        });
+        report(period == 2000 ? "full sweep, every 2 s   " : "full sweep, every 50 ms  ", r);
+    }
+    return 0;
+}
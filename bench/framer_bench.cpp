@@ -0,0 +1,82 @@
+// framer_bench.cpp - lines/sec of the old read loop vs. LineFramer
+//
+// Feeds the same stream of REGISTER/HEARTBEAT lines, cut into reads of
+// varying size, through the pre-framer handleClient loop (memset, copy into
+// std::string, substr/erase per line) and through LineFramer.
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../line_framer.hpp"
+
+const size_t READ_SIZE = 1023; // the old loop read at most sizeof(buffer) - 1
+const int ROUNDS = 20;
+
+// The original loop, minus the socket. Lines split across reads are lost.
+size_t legacyLoop(const std::vector<std::string_view> &reads) {
+    size_t lines = 0;
+    char buffer[1024];
+    for (std::string_view chunk : reads) {
+        memset(buffer, 0, sizeof(buffer));
+        memcpy(buffer, chunk.data(), chunk.size());
+        std::string msg(buffer);
+
+        size_t pos = 0;
+        while ((pos = msg.find('\n')) != std::string::npos) {
+            std::string line = msg.substr(0, pos);
+            msg.erase(0, pos + 1);
+            line.erase(0, line.find_first_not_of(" \t\r"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            lines += line.size() > 0;
+        }
+    }
+    return lines;
+}
+
+size_t framerLoop(const std::vector<std::string_view> &reads) {
+    size_t lines = 0;
+    LineFramer framer;
+    for (std::string_view chunk : reads) {
+        framer.feed(chunk.data(), chunk.size(), [&lines](std::string_view line, size_t) {
+            lines += line.size() > 0;
+        });
+    }
+    return lines;
+}
+
+template <typename Fn>
+void run(const char *name, Fn fn, const std::vector<std::string_view> &reads, size_t expected) {
+    size_t lines = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) lines += fn(reads);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << (uint64_t)(lines / secs) << " lines/s, "
+              << lines / ROUNDS << " lines dispatched per pass (" << expected
+              << " sent, split lines arrive mangled in the legacy loop)" << std::endl;
+}
+
+int main() {
+    std::mt19937 rng(42);
+    std::string stream;
+    size_t expected = 0;
+    while (stream.size() < 64 * 1024 * 1024) {
+        std::string node = "node" + std::to_string(rng() % 100000);
+        stream += (rng() % 16 == 0 ? "REGISTER " : "HEARTBEAT ") + node + "\n";
+        expected++;
+    }
+
+    // Cut the stream into reads of 1..READ_SIZE bytes, like a busy socket
+    std::vector<std::string_view> reads;
+    for (size_t off = 0; off < stream.size();) {
+        size_t n = std::min(stream.size() - off, 1 + rng() % READ_SIZE);
+        reads.emplace_back(stream.data() + off, n);
+        off += n;
+    }
+
+    run("legacy loop", legacyLoop, reads, expected);
+    run("LineFramer ", framerLoop, reads, expected);
+    return 0;
+}
@@ -0,0 +1,107 @@
+// idle_conn_bench.cpp - memory per idle connection: threads vs. coroutines
+//
+// The original manager ran every worker connection on a detached thread
+// blocked in read(). The reactor now keeps a Connection and a pooled
+// protocol coroutine per worker instead. Each model is measured in its own
+// child process: RSS growth (and address space) per idle connection.
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../reactor.hpp"
+
+struct Usage {
+    long rss_kb = 0;
+    long vm_kb = 0;
+};
+
+Usage usage() {
+    Usage u;
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    long value;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> value) u.rss_kb = value;
+        else if (key == "VmSize:" && status >> value) u.vm_kb = value;
+    }
+    return u;
+}
+
+void report(const char *model, int n, const Usage &before, const Usage &after) {
+    std::cout << model << ": " << n << " idle connections, "
+              << (after.rss_kb - before.rss_kb) * 1024 / n << " bytes RSS each, "
+              << (after.vm_kb - before.vm_kb) * 1024 / n << " bytes address space each" << std::endl;
+}
+
+// The old model: one thread per worker, parked in read()
+void threadModel(int n) {
+    std::vector<int> peers;
+    Usage before = usage();
+    for (int i = 0; i < n; i++) {
+        int sv[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) break;
+        peers.push_back(sv[1]);
+        std::thread([fd = sv[0]] {
+            char buffer[1024];
+            while (read(fd, buffer, sizeof(buffer)) > 0) {}
+            close(fd);
+        }).detach();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    report("thread per connection", peers.size(), before, usage());
+}
+
+// Same shape as the manager's serveConnection
+Task serve(Connection &conn) {
+    while (!conn.binary) {
+        TextLine line = co_await conn.readLine();
+        if (line.text == "PROTO 1") conn.binary = true;
+    }
+    while (true) {
+        FrameView f = co_await conn.readFrame();
+        (void)f;
+    }
+}
+
+// The reactor model: a Connection plus its suspended coroutine
+void coroutineModel(int n) {
+    std::vector<std::unique_ptr<Connection>> connections;
+    connections.reserve(n);
+    Usage before = usage();
+    for (int i = 0; i < n; i++) {
+        connections.emplace_back(new Connection());
+        Connection &conn = *connections.back();
+        conn.fd = -1;
+        conn.handler = serve(conn);
+    }
+    Usage after = usage();
+    report("coroutine per connection", n, before, after);
+    std::cout << "  sizeof(Connection)=" << sizeof(Connection)
+              << ", pooled frames live=" << FramePool::liveFrames()
+              << ", pool reserved " << FramePool::reservedBytes() / n << " bytes per connection"
+              << std::endl;
+}
+
+template <typename Fn>
+void inChild(Fn fn) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? atoi(argv[1]) : 2000;
+    int coroutines = argc > 2 ? atoi(argv[2]) : 100000;
+    inChild([&] { threadModel(threads); });
+    inChild([&] { coroutineModel(coroutines); });
+    return 0;
+}
@@ -0,0 +1,231 @@
+// loadgen.cpp - heartbeat load generator for the manager
+//
+// Opens many worker connections, registers each one and then pipelines
+// heartbeats as fast as the manager will take them. Socket buffers hide a
+// lot of in-flight data, so the reported rate comes from the manager's own
+// STATS counter sampled at the start and end of the run.
+//
+// --format id sends legacy "HEARTBEAT <id>" lines; --format hb reads the
+// handle from the REGISTER reply and sends "HB <handle>", the path that goes
+// through the manager's applier queue when --appliers is set.
+//
+// --unix PATH connects to the manager's AF_UNIX listener instead of TCP.
+// --pings N first measures N sequential STATS round trips on an otherwise
+// idle connection and reports their latency percentiles.
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <algorithm>
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 5050;
+    int connections = 1000;
+    int threads = 4;
+    int seconds = 10;
+    int batch = 32;  // heartbeat lines per write()
+    int sources = 1; // loopback source addresses (127.0.0.x) to spread ports over
+    bool handles = false; // --format hb
+    std::string unix_path; // connect over AF_UNIX instead of TCP
+    int pings = 0;
+};
+
+std::atomic<uint64_t> heartbeats_sent{0};
+std::atomic<bool> stop{false};
+std::atomic<int> threads_ready{0};
+
+// A single source address runs out of ephemeral ports around 28k
+// connections, so large runs rotate through 127.0.0.1..N.
+int connectTo(const Options &opt, int index) {
+    if (!opt.unix_path.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        opt.unix_path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+        int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+            close(sock);
+            return -1;
+        }
+        return sock;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    if (opt.sources > 1) {
+        int one = 1;
+        setsockopt(sock, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(0x7f000001 + index % opt.sources);
+        bind(sock, (struct sockaddr*)&local, sizeof(local));
+    }
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void runThread(const Options &opt, int thread_id, int count) {
+    std::vector<int> socks;
+    std::vector<std::string> payloads;
+    for (int i = 0; i < count; i++) {
+        std::string node_id = "bench-" + std::to_string(thread_id) + "-" + std::to_string(i);
+        int sock = connectTo(opt, i * opt.threads + thread_id);
+        if (sock < 0) {
+            std::cerr << "[WARN] connect failed for " << node_id << ": " << strerror(errno) << "\n";
+            break;
+        }
+        std::string reg = "REGISTER " + node_id + "\n";
+        send(sock, reg.c_str(), reg.size(), 0);
+
+        std::string line = "HEARTBEAT " + node_id + "\n";
+        if (opt.handles) {
+            char reply[64] = {0};
+            ssize_t n = recv(sock, reply, sizeof(reply) - 1, 0);
+            if (n <= 3 || strncmp(reply, "OK ", 3) != 0) {
+                std::cerr << "[WARN] no handle for " << node_id << "\n";
+                close(sock);
+                break;
+            }
+            line = "HB " + std::to_string(strtoul(reply + 3, nullptr, 10)) + "\n";
+        }
+
+        std::string payload;
+        for (int b = 0; b < opt.batch; b++) payload += line;
+        socks.push_back(sock);
+        payloads.push_back(payload);
+    }
+
+    threads_ready++;
+    while (!stop && !socks.empty()) {
+        for (size_t i = 0; i < socks.size() && !stop; i++) {
+            if (send(socks[i], payloads[i].data(), payloads[i].size(), 0) > 0) {
+                heartbeats_sent.fetch_add(opt.batch, std::memory_order_relaxed);
+            }
+        }
+    }
+    for (int sock : socks) close(sock);
+}
+
+// Returns the manager's STATS line, or an empty string
+std::string queryStats(const Options &opt) {
+    int sock = connectTo(opt, 0);
+    if (sock < 0) return "";
+    send(sock, "STATS\n", 6, 0);
+    char buf[512] = {0};
+    ssize_t n = recv(sock, buf, sizeof(buf) - 1, 0);
+    close(sock);
+    if (n <= 0) return "";
+    std::string line(buf, n);
+    if (!line.empty() && line.back() == '\n') line.pop_back();
+    return line;
+}
+
+// How many heartbeats the manager had processed when it wrote the line
+uint64_t processedIn(const std::string &line) {
+    size_t p = line.find("heartbeats=");
+    return p == std::string::npos ? 0 : strtoull(line.c_str() + p + 11, nullptr, 10);
+}
+
+// Sequential request/reply round trips, so the transport cost is not
+// hidden behind pipelining
+void measureRoundTrips(const Options &opt) {
+    int sock = connectTo(opt, 0);
+    if (sock < 0) return;
+    std::vector<double> rtt_us;
+    char buf[512];
+    for (int i = 0; i < opt.pings; i++) {
+        auto start = std::chrono::steady_clock::now();
+        send(sock, "STATS\n", 6, 0);
+        ssize_t n;
+        while ((n = recv(sock, buf, sizeof(buf), 0)) > 0 && buf[n - 1] != '\n') {}
+        if (n <= 0) break;
+        rtt_us.push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    close(sock);
+    if (rtt_us.empty()) return;
+    std::sort(rtt_us.begin(), rtt_us.end());
+    std::cout << "round trips=" << rtt_us.size()
+              << " p50=" << rtt_us[rtt_us.size() / 2] << "us"
+              << " p99=" << rtt_us[rtt_us.size() * 99 / 100] << "us" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--host") opt.host = argv[i + 1];
+        else if (arg == "--port") opt.port = atoi(argv[i + 1]);
+        else if (arg == "--connections") opt.connections = atoi(argv[i + 1]);
+        else if (arg == "--threads") opt.threads = atoi(argv[i + 1]);
+        else if (arg == "--seconds") opt.seconds = atoi(argv[i + 1]);
+        else if (arg == "--batch") opt.batch = atoi(argv[i + 1]);
+        else if (arg == "--sources") opt.sources = atoi(argv[i + 1]);
+        else if (arg == "--format") opt.handles = std::string(argv[i + 1]) == "hb";
+        else if (arg == "--unix") opt.unix_path = argv[i + 1];
+        else if (arg == "--pings") opt.pings = atoi(argv[i + 1]);
+        else {
+            std::cerr << "Usage: ./loadgen [--host H] [--port P] [--connections N] "
+                         "[--threads T] [--seconds S] [--batch B] [--sources K] [--format id|hb]\n"
+                         "               [--unix PATH] [--pings N]\n";
+            return 1;
+        }
+    }
+
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    if (opt.pings > 0) measureRoundTrips(opt);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        int count = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        threads.emplace_back(runThread, std::cref(opt), t, count);
+    }
+
+    // Wait for every connection to be established so setup does not skew
+    // the rate, then skip one more second of warm-up
+    while (threads_ready < opt.threads) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    uint64_t start_sent = heartbeats_sent.load();
+    uint64_t start_processed = processedIn(queryStats(opt));
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+    std::string final_stats = queryStats(opt);
+    uint64_t processed = processedIn(final_stats) - start_processed;
+    uint64_t sent = heartbeats_sent.load() - start_sent;
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stop = true;
+    for (auto &t : threads) t.join();
+
+    std::cout << "connections=" << opt.connections
+              << " sent=" << sent
+              << " processed=" << processed
+              << " rate=" << (uint64_t)(processed / elapsed) << "/s" << std::endl;
+    std::cout << "manager: " << final_stats << std::endl;
+    return 0;
+}
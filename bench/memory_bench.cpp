@@ -0,0 +1,143 @@
+// memory_bench.cpp - bytes per node at 100k and 1M nodes
+//
+// Each size runs in a child process so RSS starts from the same baseline.
+// The child fills a NodeTable with N registered nodes, heartbeats them all
+// once and walks it, then reports the RSS it gained and the bytes the
+// table accounts for (record blocks and index slots).
+//
+// The table is most but not all of the manager, so the manager itself is
+// measured too: it loads a checkpoint of MANAGER_NODES nodes (with
+// --max-nodes) in a scratch directory, and its RSS is sampled once it
+// listens and then for MANAGER_RUN_S seconds of display and persistence
+// passes. Pass the manager's path as the argument, ./manager by default
+// (run from the repository root after `make -f MAKEFILE all bench`). It
+// listens on the usual port, so stop any running manager first.
+#include <iostream>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../node_table.hpp"
+
+const size_t MANAGER_NODES = 1000000;
+const int MANAGER_RUN_S = 30;
+
+// A field of /proc/<pid>/status in kB, 0 if missing
+long statusKb(const std::string &pid, const char *field) {
+    long kb = 0;
+    FILE *f = fopen(("/proc/" + pid + "/status").c_str(), "r");
+    if (!f) return 0;
+    char line[256];
+    std::string format = std::string(field) + ": %ld kB";
+    while (fgets(line, sizeof(line), f)) {
+        if (sscanf(line, format.c_str(), &kb) == 1) break;
+    }
+    fclose(f);
+    return kb;
+}
+
+long rssKb() { return statusKb("self", "VmRSS"); }
+
+void measure(size_t nodes, bool reserve) {
+    long before = rssKb();
+    NodeTable table;
+    if (reserve) table.reserve(nodes);
+    std::vector<uint32_t> handles;
+    handles.reserve(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        handles.push_back(table.join("rack" + std::to_string(i % 512) + "-node" + std::to_string(i), 1000000));
+    }
+    table.touchAll(handles.data(), handles.size(), 2000000);
+    size_t active = 0;
+    table.forEach([&active](const NodeView &node) { active += node.status == NodeStatus::Active; });
+    long gained = rssKb() - before - long(handles.capacity() * sizeof(uint32_t) / 1024);
+
+    SlabStats records = table.recordStats();
+    SlabStats index = table.indexStats();
+    size_t accounted = records.capacity * records.object_size + index.capacity * index.object_size;
+    printf("  %7zu nodes%s: RSS +%6.1f MB, %5.1f bytes/node, %5.1f MB accounted (records %zu B + index %.1f B), "
+           "%zu active\n",
+           nodes, reserve ? ", reserved" : "         ", gained / 1024.0, gained * 1024.0 / nodes,
+           accounted / 1048576.0, records.object_size, double(index.capacity * index.object_size) / nodes, active);
+}
+
+// The manager after loading a checkpoint of `nodes` nodes
+void measureManager(const char *manager, size_t nodes) {
+    char dir[] = "/tmp/memory_bench.XXXXXX";
+    if (!mkdtemp(dir)) return;
+    std::string path(dir);
+    {
+        // The layout writeCheckpoint() uses, every node active and just seen
+        std::ofstream file(path + "/cluster_state.json");
+        time_t now = time(nullptr);
+        const char *separator = "{\n";
+        for (size_t i = 0; i < nodes; i++) {
+            file << separator << "    \"rack" << i % 512 << "-node" << i << "\": {\"last_seen\":" << now
+                 << ",\"since\":" << now << ",\"status\":\"active\"}";
+            separator = ",\n";
+        }
+        file << "\n}\n";
+    }
+
+    std::string binary = std::filesystem::absolute(manager); // the child runs in `dir`
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        if (chdir(dir) == 0) {
+            std::string max_nodes = std::to_string(nodes);
+            execl(binary.c_str(), binary.c_str(), "primary", "--max-nodes", max_nodes.c_str(), "--timeout-ms", "600000", nullptr);
+        }
+        _exit(127);
+    }
+
+    // The manager logs to manager.log in its working directory
+    std::string line;
+    bool listening = false;
+    while (!listening && waitpid(pid, nullptr, WNOHANG) == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        std::ifstream log(path + "/manager.log");
+        while (std::getline(log, line)) listening |= line.find("listening") != std::string::npos;
+    }
+    if (listening) {
+        double load_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string id = std::to_string(pid);
+        long loaded = statusKb(id, "VmRSS");
+        std::this_thread::sleep_for(std::chrono::seconds(MANAGER_RUN_S));
+        printf("  manager, %zu nodes: loaded in %.1f s, RSS %.1f MB then, %.1f MB after %d s, %.1f MB peak\n",
+               nodes, load_s, loaded / 1024.0, statusKb(id, "VmRSS") / 1024.0, MANAGER_RUN_S,
+               statusKb(id, "VmHWM") / 1024.0);
+        kill(pid, SIGKILL);
+    } else {
+        printf("  manager: %s did not start\n", manager);
+    }
+    waitpid(pid, nullptr, 0);
+    std::filesystem::remove_all(path);
+}
+
+int main(int argc, char *argv[]) {
+    for (bool reserve : {false, true}) {
+        for (size_t nodes : {100000, 1000000}) {
+            fflush(stdout);
+            pid_t pid = fork();
+            if (pid == 0) {
+                measure(nodes, reserve);
+                fflush(stdout);
+                _exit(0);
+            }
+            waitpid(pid, nullptr, 0);
+        }
+    }
+    fflush(stdout);
+    measureManager(argc > 1 ? argv[1] : "./manager", MANAGER_NODES);
+    return 0;
+}
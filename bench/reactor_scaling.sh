@@ -0,0 +1,29 @@
+#!/bin/bash
+# ========================================================
+# Heartbeat ingestion vs. number of manager reactors
+# ========================================================
+# Runs the manager with 1..16 reactor threads and drives it with loadgen.
+# Run from the repository root after `make -f MAKEFILE bench`.
+
+CONNECTIONS=${CONNECTIONS:-2000}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-10}
+LOADGEN_THREADS=${LOADGEN_THREADS:-8}
+WORKDIR=$(mktemp -d)
+
+echo "reactors,heartbeats_per_sec"
+for REACTORS in 1 2 4 8 16; do
+    pkill -f "manager primary" 2>/dev/null
+    sleep 1
+    (cd "$WORKDIR" && exec "$OLDPWD/manager" primary --reactors $REACTORS > manager.out 2>&1) &
+    MANAGER_PID=$!
+    sleep 1
+
+    RESULT=$(./bench/loadgen --connections $CONNECTIONS --threads $LOADGEN_THREADS \
+                             --seconds $SECONDS_PER_RUN)
+    RATE=$(echo "$RESULT" | sed -n 's/.*rate=\([0-9]*\).*/\1/p')
+    echo "$REACTORS,$RATE"
+
+    kill -9 $MANAGER_PID 2>/dev/null
+    wait $MANAGER_PID 2>/dev/null
+done
+rm -rf "$WORKDIR"
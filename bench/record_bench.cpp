@@ -0,0 +1,213 @@
+// record_bench.cpp - per-record seqlock: torn-read stress and throughput
+//
+// Stress: writers rewrite whole records while readers check every copy
+// they get. Every time written is a whole number of seconds v after BASE
+// and encodes a status as v % 5. Upsert writers store last_seen = since
+// = v with status v % 5 (since only if the status changes); leave writers
+// move the same records to left with since = v, v % 5 == left, so two
+// writers also contend for one record. A reader must never see a since,
+// or outside left a last_seen, that does not match the status.
+//
+// Throughput: heartbeats, a sweep failing whatever went quiet (so
+// heartbeats keep reviving nodes) and point reads, against the same
+// records guarded by a mutex per shard.
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../clock.hpp"
+#include "../node_table.hpp"
+
+const size_t NODES = 1 << 16;
+const int WRITERS = 2;
+const int READERS = 2;
+const int64_t RUN_MS = 2000;
+const int64_t MS = 1000000;
+const int64_t SECOND = 1000000000;
+const int64_t BASE = LivenessClock::read() / SECOND * SECOND; // times stay near the liveness clock
+
+using Clock = std::chrono::steady_clock;
+
+std::vector<std::string> ids;
+
+int64_t at(int64_t v) { return BASE + v * SECOND; }
+int64_t tagOf(int64_t t) { return (t - BASE) / SECOND % 5; }
+
+bool consistent(const NodeView &v) {
+    if (tagOf(v.since) != (int64_t)v.status) return false;
+    return v.status == NodeStatus::Left || tagOf(v.last_seen) == (int64_t)v.status;
+}
+
+void stress() {
+    NodeTable table;
+    std::vector<uint32_t> handles;
+    for (size_t i = 0; i < NODES; i++) handles.push_back(table.upsert(ids[i], at(5), NodeStatus::Joining, at(5)));
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> writes{0}, reads{0}, torn{0}, walks{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < WRITERS; t++) {
+        threads.emplace_back([&, t] { // upserts, cycling joining..failed
+            std::mt19937 rng(t);
+            uint64_t done = 0;
+            for (int64_t n = 1; !stop.load(std::memory_order_relaxed); n++, done++) {
+                int64_t v = n % 100000 * 5 + n % 4;
+                table.upsert(ids[rng() % NODES], at(v), NodeStatus(v % 5), at(v));
+            }
+            writes += done;
+        });
+        threads.emplace_back([&, t] { // leaves, on the same records
+            std::mt19937 rng(100 + t);
+            uint64_t done = 0;
+            for (int64_t n = 1; !stop.load(std::memory_order_relaxed); n++, done++) {
+                table.leave(handles[rng() % NODES], at(n % 100000 * 5 + int64_t(NodeStatus::Left)));
+            }
+            writes += done;
+        });
+    }
+    for (int t = 0; t < READERS; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(200 + t);
+            uint64_t done = 0, bad = 0;
+            NodeView view{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                table.read(handles[rng() % NODES], view);
+                bad += !consistent(view);
+                done++;
+            }
+            reads += done;
+            torn += bad;
+        });
+    }
+    threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            table.forEach([&](const NodeView &view) { torn += !consistent(view); });
+            walks++;
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    stop = true;
+    for (auto &t : threads) t.join();
+    std::cout << "stress: " << writes << " record writes, " << reads << " reads, " << walks
+              << " walks, " << torn << " torn" << (torn ? "  <-- FAILED" : "") << std::endl;
+}
+
+// The same records behind one mutex per shard
+class MutexTable {
+public:
+    explicit MutexTable(size_t n) : last_seen(n), status(n, NodeStatus::Active), since(n) {}
+
+    void touch(uint32_t i, int64_t now) {
+        std::lock_guard<std::mutex> lock(shards[i % SHARDS]);
+        last_seen[i] = now;
+        if (status[i] != NodeStatus::Active) {
+            status[i] = NodeStatus::Active;
+            since[i] = now;
+        }
+    }
+    void sweep(int64_t cutoff, int64_t now) {
+        for (size_t i = 0; i < last_seen.size(); i++) {
+            std::lock_guard<std::mutex> lock(shards[i % SHARDS]);
+            if (last_seen[i] <= cutoff && status[i] == NodeStatus::Active) {
+                status[i] = NodeStatus::Failed;
+                since[i] = now;
+            }
+        }
+    }
+    bool read(uint32_t i, NodeView &view) {
+        std::lock_guard<std::mutex> lock(shards[i % SHARDS]);
+        view = NodeView{i, {}, last_seen[i], status[i], since[i]};
+        return true;
+    }
+
+private:
+    static const size_t SHARDS = 16;
+    std::mutex shards[SHARDS];
+    std::vector<int64_t> last_seen;
+    std::vector<NodeStatus> status;
+    std::vector<int64_t> since;
+};
+
+// Writers heartbeat random nodes, one thread sweeps with a cutoff a
+// little behind the writers' clock (a millisecond per 256 heartbeats),
+// readers read random nodes
+template <typename Table>
+void throughput(const char *name, Table &table, const std::vector<uint32_t> &handles) {
+    std::atomic<bool> stop{false};
+    std::atomic<int64_t> clock{BASE};
+    std::atomic<uint64_t> beats{0}, reads{0}, sweeps{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < WRITERS; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            uint64_t done = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int64_t now = clock.fetch_add(MS, std::memory_order_relaxed);
+                for (int i = 0; i < 256; i++) table.touch(handles[rng() % handles.size()], now);
+                done += 256;
+            }
+            beats += done;
+        });
+    }
+    for (int t = 0; t < READERS; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(200 + t);
+            uint64_t done = 0;
+            NodeView view{};
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 256; i++) table.read(handles[rng() % handles.size()], view);
+                done += 256;
+            }
+            reads += done;
+        });
+    }
+    threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            int64_t now = clock.load(std::memory_order_relaxed);
+            table.sweep(now - 1000 * MS, now);
+            sweeps++;
+        }
+    });
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    stop = true;
+    for (auto &t : threads) t.join();
+    double s = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << "  " << name << ": " << beats / s / 1e6 << " M heartbeats/s, " << reads / s / 1e6
+              << " M reads/s, " << sweeps / s << " sweeps/s" << std::endl;
+}
+
+// NodeTable::sweep() with the same single cutoff
+struct SeqlockTable {
+    NodeTable &table;
+    void touch(uint32_t h, int64_t now) { table.touch(h, now); }
+    void sweep(int64_t cutoff, int64_t now) { table.sweep(cutoff, cutoff, now); }
+    bool read(uint32_t h, NodeView &view) { return table.read(h, view); }
+};
+
+int main() {
+    for (size_t i = 0; i < NODES; i++) ids.push_back("node-" + std::to_string(i));
+    std::cout << NODES << " nodes, " << WRITERS << " writers, " << READERS << " readers, "
+              << std::thread::hardware_concurrency() << " CPUs" << std::endl;
+    stress();
+
+    std::cout << "throughput:" << std::endl;
+    {
+        NodeTable nodes;
+        std::vector<uint32_t> handles;
+        for (size_t i = 0; i < NODES; i++) handles.push_back(nodes.upsert(ids[i], BASE, NodeStatus::Active));
+        SeqlockTable table{nodes};
+        throughput("seqlock records  ", table, handles);
+    }
+    {
+        MutexTable table(NODES);
+        std::vector<uint32_t> handles;
+        for (uint32_t i = 0; i < NODES; i++) handles.push_back(i);
+        throughput("mutex per shard  ", table, handles);
+    }
+    return 0;
+}
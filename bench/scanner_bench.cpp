@@ -0,0 +1,97 @@
+// scanner_bench.cpp - line + verb splitting over 64 KB receive buffers
+//
+// Compares the per-line memchr / trim / prefix-match chain the manager used
+// before the scanner with each scanner kernel this CPU supports. Every
+// variant classifies each line as REGISTER or HEARTBEAT and sums the ID
+// lengths, so they all do the same work per line.
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "../text_scanner.hpp"
+
+const size_t BUFFER_SIZE = 64 * 1024;
+const int ROUNDS = 2000;
+
+volatile uint64_t sink; // keeps results observable
+
+std::string_view trim(std::string_view line) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    return line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+}
+
+// The previous dispatch: memchr per line, trim, then a prefix test per verb
+uint64_t legacyChain(const char *buf, size_t len) {
+    uint64_t sum = 0;
+    const char *p = buf, *end = buf + len;
+    while (const char *nl = (const char *)memchr(p, '\n', end - p)) {
+        std::string_view line = trim(std::string_view(p, nl - p));
+        if (line.rfind("REGISTER ", 0) == 0) sum += line.size() - 9;
+        else if (line.rfind("HEARTBEAT ", 0) == 0) sum += line.size() - 10;
+        p = nl + 1;
+    }
+    return sum;
+}
+
+uint64_t scanned(LineScanFn scan, const char *buf, size_t len) {
+    uint64_t sum = 0;
+    LineSpan spans[128];
+    size_t off = 0;
+    while (off < len) {
+        size_t consumed;
+        size_t n = scan(buf + off, len - off, spans, 128, consumed);
+        for (size_t i = 0; i < n; i++) {
+            std::string_view verb(buf + off + spans[i].begin, spans[i].verb_end - spans[i].begin);
+            size_t arg = spans[i].end - spans[i].verb_end - 1;
+            if (verb == "REGISTER" || verb == "HEARTBEAT") sum += arg;
+        }
+        off += consumed;
+        if (n < 128) break;
+    }
+    return sum;
+}
+
+template <typename Fn>
+void run(const char *name, const std::vector<std::string> &buffers, size_t lines, Fn fn) {
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < ROUNDS; r++) {
+        const std::string &b = buffers[r % buffers.size()];
+        sum += fn(b.data(), b.size());
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    sink = sum;
+    std::cout << name << ": " << (uint64_t)(lines * ROUNDS / buffers.size() / secs) << " lines/s, "
+              << BUFFER_SIZE * ROUNDS / secs / 1e9 << " GB/s (checksum " << sum << ")" << std::endl;
+}
+
+int main() {
+    // 64 KB buffers of whole lines, roughly 1 REGISTER per 16 HEARTBEATs
+    std::mt19937 rng(42);
+    std::vector<std::string> buffers(16);
+    size_t lines = 0;
+    for (std::string &b : buffers) {
+        while (true) {
+            std::string node = "rack" + std::to_string(rng() % 64) + "-node" + std::to_string(rng() % 100000);
+            std::string line = (rng() % 16 == 0 ? "REGISTER " : "HEARTBEAT ") + node + "\n";
+            if (b.size() + line.size() > BUFFER_SIZE) break;
+            b += line;
+            lines++;
+        }
+    }
+
+    run("legacy chain", buffers, lines, legacyChain);
+    run("scalar      ", buffers, lines, [](const char *b, size_t n) { return scanned(scanLinesScalar, b, n); });
+#if defined(__x86_64__)
+    run("sse2        ", buffers, lines, [](const char *b, size_t n) { return scanned(scanLinesSse2, b, n); });
+    if (__builtin_cpu_supports("avx2")) {
+        run("avx2        ", buffers, lines, [](const char *b, size_t n) { return scanned(scanLinesAvx2, b, n); });
+    }
+#endif
+    std::cout << "runtime pick: " << lineScannerName(scanLines) << std::endl;
+    return 0;
+}
@@ -0,0 +1,75 @@
+// shard_bench.cpp - heartbeat ingest against a concurrent failure sweep
+//
+// INGEST_THREADS threads mark random nodes alive through NodeTable::touch()
+// while one more thread sweeps the whole table the way monitorNodes does.
+// Every 256th operation is a timed re-REGISTER instead, which takes its
+// shard's lock; one shard is the old single cluster_mutex. Heartbeats and
+// the sweep do not lock, so the shard count only shows up in REGISTERs.
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../node_table.hpp"
+
+const int INGEST_THREADS = 16;
+const size_t NODES = 100000;
+const double SECONDS = 2.0;
+
+volatile size_t sink; // keeps the sweep observable
+
+void run(uint32_t shard_count) {
+    NodeTable table(shard_count);
+    std::vector<std::string> ids;
+    std::vector<uint32_t> handles;
+    for (size_t i = 0; i < NODES; i++) {
+        ids.push_back("rack" + std::to_string(i % 64) + "-node" + std::to_string(i));
+        handles.push_back(table.upsert(ids.back(), 0, NodeStatus::Active));
+    }
+
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> beats{0}, sweeps{0}, max_wait_ns{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < INGEST_THREADS; t++) {
+        threads.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            uint64_t n = 0, worst = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                auto start = std::chrono::steady_clock::now();
+                table.join(ids[rng() % NODES], 1000);
+                worst = std::max<uint64_t>(worst, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - start).count());
+                for (int k = 1; k < 256; k++) n += table.touch(handles[rng() % NODES], 1000);
+            }
+            beats += n;
+            uint64_t seen = max_wait_ns.load();
+            while (worst > seen && !max_wait_ns.compare_exchange_weak(seen, worst)) {}
+        });
+    }
+    threads.emplace_back([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            size_t failed = 0;
+            table.forEach([&failed](const NodeView &node) {
+                if (node.last_seen < 500 && node.status == NodeStatus::Active) failed++;
+            });
+            sink = failed;
+            sweeps++;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::duration<double>(SECONDS));
+    stop = true;
+    for (auto &t : threads) t.join();
+    std::cout << shard_count << " shard(s): " << (uint64_t)(beats / SECONDS) << " heartbeats/s, "
+              << sweeps / SECONDS << " sweeps/s of " << NODES << " nodes, longest sampled REGISTER "
+              << max_wait_ns / 1000 << "us" << std::endl;
+}
+
+int main() {
+    std::cout << INGEST_THREADS << " ingest threads + 1 sweep, "
+              << std::thread::hardware_concurrency() << " CPU(s)" << std::endl;
+    for (uint32_t shards : {1u, 4u, NodeTable::MAX_SHARDS}) run(shards);
+    return 0;
+}
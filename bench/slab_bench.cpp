@@ -0,0 +1,80 @@
+// slab_bench.cpp - reconnect churn: operator new vs. SlabPool
+//
+// Keeps LIVE connection-sized objects alive and repeatedly replaces a
+// random one, interleaved with short-lived strings the way reconnects mix
+// with other traffic. Reports replacement rate and resident memory after
+// the churn for each allocator, in separate child processes.
+#include <iostream>
+#include <chrono>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../slab.hpp"
+
+const size_t LIVE = 200000;
+const size_t REPLACEMENTS = 5000000;
+const size_t OBJECT_SIZE = 392; // sizeof(Connection)
+
+struct Record {
+    char bytes[OBJECT_SIZE];
+};
+
+long rssKb() {
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    long value = 0;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> value) return value;
+    }
+    return 0;
+}
+
+template <typename Alloc, typename Free>
+void churn(const char *name, Alloc alloc, Free release) {
+    std::mt19937 rng(7);
+    std::vector<Record *> live(LIVE);
+    std::vector<std::string> noise(1024);
+    for (auto &p : live) p = alloc();
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < REPLACEMENTS; i++) {
+        size_t victim = rng() % LIVE;
+        release(live[victim]);
+        noise[i % noise.size()] = std::string(32 + rng() % 200, 'x');
+        live[victim] = alloc();
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << (uint64_t)(REPLACEMENTS / secs) << " replacements/s, RSS "
+              << rssKb() / 1024 << " MB for " << LIVE << " live objects" << std::endl;
+}
+
+template <typename Fn>
+void inChild(Fn fn) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        fn();
+        _exit(0);
+    }
+    waitpid(pid, nullptr, 0);
+}
+
+int main() {
+    inChild([] {
+        churn("operator new", [] { return new Record; }, [](Record *p) { delete p; });
+    });
+    inChild([] {
+        SlabPool pool(sizeof(Record));
+        churn("SlabPool    ", [&] { return pool.create<Record>(); }, [&](Record *p) { pool.destroy(p); });
+    });
+    inChild([] {
+        SlabPool::setHugePages(true);
+        SlabPool pool(sizeof(Record));
+        churn("SlabPool 2MB", [&] { return pool.create<Record>(); }, [&](Record *p) { pool.destroy(p); });
+        SlabStats s = pool.stats();
+        std::cout << "  " << s.chunks << " chunks, " << s.huge_chunks << " huge-page backed" << std::endl;
+    });
+    return 0;
+}
@@ -0,0 +1,146 @@
+// snapshot_bench.cpp - heartbeat throughput while the cluster is dumped
+//
+// INGEST_THREADS threads touch random nodes of a 1M-node table for
+// RUN_MS in three setups:
+//   - no reader
+//   - a reader dumping published snapshots back to back, formatting every
+//     node like the status display, while the publisher takes a fresh
+//     snapshot every PUBLISH_MS
+//   - the same dumps from the live table under one mutex that every
+//     heartbeat also takes, as before the table was sharded
+// The reader is one more runnable thread, so on a machine with fewer cores
+// than threads the writers lose its CPU share even when nothing blocks.
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../cluster_snapshot.hpp"
+
+const size_t NODES = 1000000;
+const int INGEST_THREADS = 2;
+const int64_t RUN_MS = 3000;
+const int64_t PUBLISH_MS = 250;
+
+using Clock = std::chrono::steady_clock;
+
+double msSince(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Roughly what displayClusterState() does per node, minus ctime()
+size_t format(std::string &out, const NodeView &node) {
+    char line[160];
+    int n = snprintf(line, sizeof(line), "%.*s | %s since %lld | Last seen: %lld\n", (int)node.id.size(),
+                     node.id.data(), statusName(node.status), (long long)node.since, (long long)node.last_seen);
+    out.append(line, n);
+    return 1;
+}
+
+struct Phase {
+    double heartbeats_per_s = 0;
+    size_t dumps = 0;
+    double dump_ms = 0; // average
+};
+
+// Runs the writers for RUN_MS with reader(stop) running alongside
+template <typename Touch, typename Reader>
+Phase run(const std::vector<uint32_t> &handles, Touch touch, Reader reader) {
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> total{0};
+    std::vector<std::thread> writers;
+    for (int t = 0; t < INGEST_THREADS; t++) {
+        writers.emplace_back([&, t] {
+            std::mt19937 rng(t);
+            uint64_t done = 0;
+            int64_t now = 1;
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (int i = 0; i < 1024; i++) touch(handles[rng() % handles.size()], now);
+                done += 1024;
+                now++;
+            }
+            total += done;
+        });
+    }
+    Phase phase;
+    std::thread reader_thread([&] { reader(stop, phase); });
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(RUN_MS));
+    stop = true;
+    for (auto &w : writers) w.join();
+    reader_thread.join();
+    phase.heartbeats_per_s = total / (msSince(start) / 1000);
+    return phase;
+}
+
+void report(const char *name, const Phase &p) {
+    std::cout << "  " << name << ": " << p.heartbeats_per_s / 1e6 << " M heartbeats/s";
+    if (p.dumps) std::cout << ", " << p.dumps << " dumps of " << p.dump_ms << " ms";
+    std::cout << std::endl;
+}
+
+int main() {
+    NodeTable table;
+    std::vector<uint32_t> handles;
+    for (size_t i = 0; i < NODES; i++) {
+        handles.push_back(table.upsert("rack" + std::to_string(i % 512) + "-node" + std::to_string(i), 1,
+                                       NodeStatus::Active));
+    }
+    std::cout << NODES << " nodes, " << INGEST_THREADS << " ingest threads, "
+              << std::thread::hardware_concurrency() << " CPUs" << std::endl;
+
+    auto touch = [&table](uint32_t h, int64_t now) { table.touch(h, now); };
+    report("no reader                ", run(handles, touch, [](std::atomic<bool> &, Phase &) {}));
+
+    SnapshotStore snapshots(table);
+    double publish_ms = 0;
+    size_t publishes = 0;
+    Phase p = run(handles, touch, [&](std::atomic<bool> &stop, Phase &phase) {
+        auto last_publish = Clock::now() - std::chrono::milliseconds(PUBLISH_MS);
+        while (!stop.load(std::memory_order_relaxed)) {
+            // The monitor publishes; a single thread stands in for both here
+            if (msSince(last_publish) >= PUBLISH_MS) {
+                last_publish = Clock::now();
+                snapshots.publish(0);
+                publish_ms += msSince(last_publish);
+                publishes++;
+            }
+            auto start = Clock::now();
+            std::string out;
+            snapshots.read([&out](const ClusterSnapshot &s) {
+                s.forEach([&out](const NodeView &node) { format(out, node); });
+            });
+            phase.dump_ms += msSince(start);
+            phase.dumps++;
+        }
+        phase.dump_ms /= phase.dumps;
+    });
+    report("dumping snapshots        ", p);
+    SnapshotStats s = snapshots.stats();
+    std::cout << "    publish " << publish_ms / publishes << " ms, " << s.published << " published, " << s.freed
+              << " freed, " << s.retired << " still retired" << std::endl;
+
+    std::mutex table_mutex;
+    auto locked_touch = [&](uint32_t h, int64_t now) {
+        std::lock_guard<std::mutex> lock(table_mutex);
+        table.touch(h, now);
+    };
+    report("dumping under table mutex", run(handles, locked_touch, [&](std::atomic<bool> &stop, Phase &phase) {
+        while (!stop.load(std::memory_order_relaxed)) {
+            auto start = Clock::now();
+            std::string out;
+            {
+                std::lock_guard<std::mutex> lock(table_mutex);
+                table.forEach([&out](const NodeView &node) { format(out, node); });
+            }
+            phase.dump_ms += msSince(start);
+            phase.dumps++;
+        }
+        phase.dump_ms /= phase.dumps;
+    }));
+    return 0;
+}
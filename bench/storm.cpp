@@ -0,0 +1,215 @@
+// storm.cpp - reconnect storm against a freshly started manager
+//
+// Simulates every worker of a cluster reconnecting at the same moment, as
+// happens when the backup takes over: all connections are opened at once,
+// each sends REGISTER, honours "RETRY <ms>" replies like the worker does
+// and reconnects after the worker's retry interval if the connection
+// fails. Reports how long it took until every node had its "OK <handle>".
+#include <iostream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+const int RECONNECT_MS = 3000; // worker.cpp RETRY_INTERVAL
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 5050;
+    int connections = 10000;
+    int threads = 4;
+    int sources = 1; // loopback source addresses (127.0.0.x) to spread ports over
+    std::string prefix = "storm";
+};
+
+std::atomic<int> registered{0};
+std::atomic<uint64_t> retries{0}, reconnects{0};
+
+using Clock = std::chrono::steady_clock;
+
+struct Worker {
+    std::string id;
+    int fd = -1;
+    bool sent = false;
+    bool done = false;
+    Clock::time_point wake; // when to (re)connect or resend
+    std::string reply;
+};
+
+int startConnect(const Options &opt, int index) {
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(opt.port);
+    inet_pton(AF_INET, opt.host.c_str(), &addr.sin_addr);
+
+    int sock = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (opt.sources > 1) {
+        int one = 1;
+        setsockopt(sock, IPPROTO_IP, IP_BIND_ADDRESS_NO_PORT, &one, sizeof(one));
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(0x7f000001 + index % opt.sources);
+        bind(sock, (struct sockaddr*)&local, sizeof(local));
+    }
+    if (connect(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+void runThread(const Options &opt, int thread_id, int count) {
+    std::mt19937 rng(thread_id);
+    int ep = epoll_create1(0);
+    std::vector<Worker> workers(count);
+    auto now = Clock::now();
+    for (int i = 0; i < count; i++) {
+        workers[i].id = opt.prefix + "-" + std::to_string(thread_id) + "-" + std::to_string(i);
+        workers[i].wake = now;
+    }
+
+    auto fail = [&](Worker &w) {
+        epoll_ctl(ep, EPOLL_CTL_DEL, w.fd, nullptr);
+        close(w.fd);
+        w.fd = -1;
+        w.wake = Clock::now() + std::chrono::milliseconds(RECONNECT_MS);
+        reconnects++;
+    };
+    auto sendRegister = [&](Worker &w) {
+        std::string msg = "REGISTER " + w.id + "\n";
+        if (send(w.fd, msg.data(), msg.size(), MSG_NOSIGNAL) != (ssize_t)msg.size()) return fail(w);
+        w.sent = true;
+    };
+
+    int remaining = count;
+    std::vector<epoll_event> events(1024);
+    while (remaining > 0) {
+        now = Clock::now();
+        for (int i = 0; i < count; i++) {
+            Worker &w = workers[i];
+            if (w.done || w.wake > now) continue;
+            w.wake = Clock::time_point::max();
+            if (w.fd < 0) {
+                w.sent = false;
+                w.fd = startConnect(opt, i * opt.threads + thread_id);
+                if (w.fd < 0) {
+                    w.wake = now + std::chrono::milliseconds(RECONNECT_MS);
+                    continue;
+                }
+                epoll_event ev{};
+                ev.events = EPOLLIN | EPOLLOUT;
+                ev.data.u32 = i;
+                epoll_ctl(ep, EPOLL_CTL_ADD, w.fd, &ev);
+            } else {
+                sendRegister(w); // RETRY delay has passed
+            }
+        }
+
+        int n = epoll_wait(ep, events.data(), events.size(), 5);
+        for (int e = 0; e < n; e++) {
+            Worker &w = workers[events[e].data.u32];
+            if (w.fd < 0 || w.done) continue;
+            if (events[e].events & (EPOLLERR | EPOLLHUP)) {
+                fail(w);
+                continue;
+            }
+            if ((events[e].events & EPOLLOUT) && !w.sent) {
+                epoll_event ev{};
+                ev.events = EPOLLIN;
+                ev.data.u32 = events[e].data.u32;
+                epoll_ctl(ep, EPOLL_CTL_MOD, w.fd, &ev);
+                sendRegister(w);
+                continue;
+            }
+            if (!(events[e].events & EPOLLIN)) continue;
+
+            char buf[256];
+            ssize_t got = recv(w.fd, buf, sizeof(buf), 0);
+            if (got <= 0) {
+                if (got < 0 && errno == EAGAIN) continue;
+                fail(w);
+                continue;
+            }
+            w.reply.append(buf, got);
+            size_t nl;
+            while ((nl = w.reply.find('\n')) != std::string::npos) {
+                std::string line = w.reply.substr(0, nl);
+                w.reply.erase(0, nl + 1);
+                if (line.rfind("OK ", 0) == 0) {
+                    w.done = true;
+                    remaining--;
+                    registered++;
+                } else if (line.rfind("RETRY ", 0) == 0) {
+                    int ms = std::max(1, atoi(line.c_str() + 6));
+                    w.wake = Clock::now() + std::chrono::milliseconds(ms + rng() % (ms + 1));
+                    retries++;
+                }
+            }
+        }
+    }
+    // Keep the connections open until every thread is done, like idle workers
+    while (registered < opt.connections) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (Worker &w : workers) close(w.fd);
+    close(ep);
+}
+
+int main(int argc, char* argv[]) {
+    signal(SIGPIPE, SIG_IGN);
+    Options opt;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--host") opt.host = argv[i + 1];
+        else if (arg == "--port") opt.port = atoi(argv[i + 1]);
+        else if (arg == "--connections") opt.connections = atoi(argv[i + 1]);
+        else if (arg == "--threads") opt.threads = atoi(argv[i + 1]);
+        else if (arg == "--sources") opt.sources = atoi(argv[i + 1]);
+        else if (arg == "--prefix") opt.prefix = argv[i + 1];
+        else {
+            std::cerr << "Usage: ./storm [--host H] [--port P] [--connections N] "
+                         "[--threads T] [--sources K] [--prefix ID]\n";
+            return 1;
+        }
+    }
+
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+
+    auto start = Clock::now();
+    std::vector<std::thread> threads;
+    for (int t = 0; t < opt.threads; t++) {
+        int count = opt.connections / opt.threads + (t < opt.connections % opt.threads ? 1 : 0);
+        threads.emplace_back(runThread, std::cref(opt), t, count);
+    }
+    std::thread progress([&] {
+        while (registered < opt.connections) {
+            std::this_thread::sleep_for(std::chrono::seconds(1));
+            std::cerr << "  " << registered << "/" << opt.connections << " registered\n";
+        }
+    });
+    for (auto &t : threads) t.join();
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+    progress.join();
+
+    std::cout << "registered=" << registered << "/" << opt.connections
+              << " seconds=" << secs
+              << " retry_replies=" << retries
+              << " reconnects=" << reconnects << std::endl;
+    return 0;
+}
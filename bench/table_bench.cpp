@@ -0,0 +1,90 @@
+// table_bench.cpp - insert, lookup and full scan: std::map vs. NodeTable
+//
+// The baseline is the original cluster layout, std::map<std::string,
+// NodeInfo> with heap strings. NodeTable keeps IDs inline, indexes them
+// with an open-addressing table and stores records in contiguous blocks.
+// The scan is the monitorNodes failure check.
+#include <iostream>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "../node_table.hpp"
+
+const int SCANS = 5;
+
+volatile size_t sink; // keeps results observable
+
+struct LegacyInfo {
+    std::string id;
+    time_t last_seen;
+    std::string status;
+};
+
+template <typename Fn>
+double nsPer(size_t ops, Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+void report(const char *name, size_t n, double insert_ns, double lookup_ns, double scan_ns) {
+    std::cout << "  " << name << ": insert " << insert_ns << " ns, lookup " << lookup_ns
+              << " ns, scan " << scan_ns << " ns/node (" << scan_ns * n / 1e6 << " ms per sweep)" << std::endl;
+}
+
+void run(size_t n) {
+    std::vector<std::string> ids;
+    for (size_t i = 0; i < n; i++) ids.push_back("rack" + std::to_string(i % 512) + "-node" + std::to_string(i));
+    std::vector<size_t> probes(n);
+    std::mt19937 rng(1);
+    for (auto &p : probes) p = rng() % n;
+    std::cout << n << " nodes" << std::endl;
+
+    {
+        std::map<std::string, LegacyInfo> cluster;
+        double insert_ns = nsPer(n, [&] {
+            for (auto &id : ids) cluster[id] = LegacyInfo{id, 1000, "active"};
+        });
+        double lookup_ns = nsPer(n, [&] {
+            size_t hits = 0;
+            for (size_t p : probes) hits += cluster.find(ids[p]) != cluster.end();
+            sink = hits;
+        });
+        double scan_ns = nsPer(n * SCANS, [&] {
+            for (int r = 0; r < SCANS; r++) {
+                size_t failed = 0;
+                for (auto &[id, info] : cluster) failed += info.last_seen < 500 && info.status == "active";
+                sink = failed;
+            }
+        });
+        report("std::map ", n, insert_ns, lookup_ns, scan_ns);
+    }
+    {
+        NodeTable cluster;
+        double insert_ns = nsPer(n, [&] {
+            for (auto &id : ids) cluster.upsert(id, 1000, NodeStatus::Active);
+        });
+        double lookup_ns = nsPer(n, [&] {
+            size_t hits = 0;
+            for (size_t p : probes) hits += cluster.find(ids[p]) != NodeTable::INVALID_HANDLE;
+            sink = hits;
+        });
+        double scan_ns = nsPer(n * SCANS, [&] {
+            for (int r = 0; r < SCANS; r++) {
+                size_t failed = 0;
+                cluster.forEach([&failed](const NodeView &node) {
+                    failed += node.last_seen < 500 && node.status == NodeStatus::Active;
+                });
+                sink = failed;
+            }
+        });
+        report("NodeTable", n, insert_ns, lookup_ns, scan_ns);
+    }
+}
+
+int main() {
+    for (size_t n : {10000, 100000, 1000000}) run(n);
+    return 0;
+}
@@ -0,0 +1,37 @@
+#!/bin/bash
+# ========================================================
+# Failover reconnect storm: time for the whole cluster to re-register
+# ========================================================
+# Registers CONNECTIONS nodes with a primary, waits for the state to be
+# persisted, kills the primary and lets a storm-mode backup take over while
+# every node reconnects at once. Needs `ulimit -n` above the connection
+# count. Run from the repository root after `make -f MAKEFILE bench`.
+
+CONNECTIONS=${CONNECTIONS:-15000}
+STORM_THREADS=${STORM_THREADS:-4}
+BACKUP_ARGS=${BACKUP_ARGS:---storm}
+WORKDIR=$(mktemp -d)
+
+pkill -f "manager primary" 2>/dev/null
+pkill -f "manager backup" 2>/dev/null
+sleep 1
+(cd "$WORKDIR" && exec "$OLDPWD/manager" primary > primary.out 2>&1) &
+PRIMARY_PID=$!
+sleep 1
+./bench/storm --connections $CONNECTIONS --threads $STORM_THREADS --prefix node 2>/dev/null > /dev/null
+sleep 12 # one display interval, so cluster_state.json holds every node
+
+(cd "$WORKDIR" && exec "$OLDPWD/manager" backup $BACKUP_ARGS > backup.out 2>&1) &
+BACKUP_PID=$!
+sleep 1
+kill -9 $PRIMARY_PID
+wait $PRIMARY_PID 2>/dev/null
+
+# Workers notice the dead primary and reconnect together
+./bench/storm --connections $CONNECTIONS --threads $STORM_THREADS --prefix node 2>/dev/null
+sleep 3
+grep "re-registered" "$WORKDIR/manager.log" | tail -1
+
+kill -9 $BACKUP_PID 2>/dev/null
+wait $BACKUP_PID 2>/dev/null
+rm -rf "$WORKDIR"
@@ -0,0 +1,36 @@
+#!/bin/bash
+# ========================================================
+# Loopback TCP vs. unix domain socket for same-host workers
+# ========================================================
+# Reports idle round-trip latency and pipelined heartbeat throughput over
+# each transport against a single manager listening on both.
+# Run from the repository root after `make -f MAKEFILE bench`.
+
+CONNECTIONS=${CONNECTIONS:-1000}
+SECONDS_PER_RUN=${SECONDS_PER_RUN:-10}
+LOADGEN_THREADS=${LOADGEN_THREADS:-4}
+PINGS=${PINGS:-20000}
+WORKDIR=$(mktemp -d)
+SOCKET_PATH="$WORKDIR/manager.sock"
+
+pkill -f "manager primary" 2>/dev/null
+sleep 1
+(cd "$WORKDIR" && exec "$OLDPWD/manager" primary --unix "$SOCKET_PATH" > manager.out 2>&1) &
+MANAGER_PID=$!
+sleep 1
+
+echo "transport,rtt_p50_us,rtt_p99_us,heartbeats_per_sec"
+for TRANSPORT in tcp unix; do
+    ARGS=""
+    [ "$TRANSPORT" = unix ] && ARGS="--unix $SOCKET_PATH"
+    RESULT=$(./bench/loadgen $ARGS --connections $CONNECTIONS --threads $LOADGEN_THREADS \
+                             --seconds $SECONDS_PER_RUN --pings $PINGS --format hb)
+    P50=$(echo "$RESULT" | sed -n 's/.*p50=\([0-9.]*\)us.*/\1/p')
+    P99=$(echo "$RESULT" | sed -n 's/.*p99=\([0-9.]*\)us.*/\1/p')
+    RATE=$(echo "$RESULT" | sed -n 's/.*rate=\([0-9]*\).*/\1/p')
+    echo "$TRANSPORT,$P50,$P99,$RATE"
+done
+
+kill -9 $MANAGER_PID 2>/dev/null
+wait $MANAGER_PID 2>/dev/null
+rm -rf "$WORKDIR"
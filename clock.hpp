@@ -0,0 +1,55 @@
+#ifndef CLOCK_HPP
+#define CLOCK_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+
+// ----------------------------------------------------
+// Liveness clock
+//
+// Node liveness is measured on CLOCK_MONOTONIC_COARSE in nanoseconds: it
+// never steps when NTP or an operator changes the wall clock, so a clock
+// change can neither fail the whole cluster nor hide a dead node. It is
+// read from the vDSO without a syscall, at the kernel tick's resolution
+// (a few ms).
+//
+// Even that read is kept off the heartbeat path: every event loop calls
+// tick() once per pass and heartbeats use the cached now(). Wall time is
+// only derived for display and persistence.
+// ----------------------------------------------------
+class LivenessClock {
+public:
+    static int64_t read() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    // Refreshes the cached time and returns it. Loops on other threads may
+    // tick concurrently; the cache only moves forward.
+    static int64_t tick() {
+        int64_t t = read();
+        int64_t cached = now_ns.load(std::memory_order_relaxed);
+        while (t > cached && !now_ns.compare_exchange_weak(cached, t, std::memory_order_relaxed)) {}
+        return t > cached ? t : cached;
+    }
+
+    static int64_t now() { return now_ns.load(std::memory_order_relaxed); }
+
+    // Conversions against the current wall clock, for display and
+    // cluster_state.json
+    static time_t toWall(int64_t ns) { return (time_t)((wallNs() - (read() - ns)) / 1000000000); }
+    static int64_t fromWall(time_t wall) { return read() - (wallNs() - (int64_t)wall * 1000000000); }
+
+private:
+    static int64_t wallNs() {
+        timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    static inline std::atomic<int64_t> now_ns{read()};
+};
+
+#endif
@@ -0,0 +1,31 @@
+// cluster_snapshot.cpp
+#include "cluster_snapshot.hpp"
+
+SnapshotStore::~SnapshotStore() {
+    delete current.load(std::memory_order_relaxed);
+}
+
+// Rounds down, also before the clock's epoch
+static int32_t seconds(int64_t t) {
+    const int64_t unit = ClusterSnapshot::SECOND;
+    return (int32_t)(t >= 0 ? t / unit : -((-t + unit - 1) / unit));
+}
+
+void SnapshotStore::publish(int64_t now) {
+    ClusterSnapshot *snapshot = new ClusterSnapshot{now, &table, {}};
+    snapshot->nodes.reserve(table.size());
+    table.forEach([snapshot](const NodeView &node) {
+        snapshot->nodes.push_back(ClusterSnapshot::Node{node.handle, node.status, seconds(node.last_seen),
+                                                        seconds(node.since)});
+    });
+
+    ClusterSnapshot *previous = current.exchange(snapshot, std::memory_order_acq_rel);
+    if (previous) epochs.retire(previous);
+    published.fetch_add(1, std::memory_order_relaxed);
+    freed.fetch_add(epochs.reclaim(), std::memory_order_relaxed);
+}
+
+SnapshotStats SnapshotStore::stats() const {
+    return SnapshotStats{published.load(std::memory_order_relaxed), freed.load(std::memory_order_relaxed),
+                         epochs.pending()};
+}
@@ -0,0 +1,90 @@
+#ifndef CLUSTER_SNAPSHOT_HPP
+#define CLUSTER_SNAPSHOT_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include "epoch.hpp"
+#include "node_table.hpp"
+
+// Immutable copy of the cluster at one point in time. Each node is kept in
+// 16 bytes, times to the second; its ID is read from the table, whose
+// records never move or go away.
+struct ClusterSnapshot {
+    struct Node {
+        uint32_t handle;
+        NodeStatus status;
+        int32_t last_seen; // LivenessClock seconds
+        int32_t since;
+    };
+
+    int64_t taken_at; // LivenessClock
+    const NodeTable *table;
+    std::vector<Node> nodes;
+
+    // Calls fn(const NodeView &) for every node in handle order; version
+    // is not kept and reads 0
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (const Node &node : nodes) {
+            fn(NodeView{node.handle, table->idOf(node.handle), node.last_seen * SECOND, node.status,
+                        node.since * SECOND, 0});
+        }
+    }
+
+    static const int64_t SECOND = 1000000000; // ns
+};
+
+struct SnapshotStats {
+    uint64_t published;
+    uint64_t freed;
+    size_t retired; // unpublished, still pinned by a reader
+};
+
+// Latest published ClusterSnapshot of a NodeTable.
+//
+// Display, persistence and any other bulk reader format from a snapshot
+// instead of walking the live table: the dump sees one consistent
+// picture however long it takes, and it never holds anything a
+// heartbeat, REGISTER or the failure detector waits on. Taking a snapshot
+// is one sequential pass over the record arrays, much cheaper than
+// formatting it.
+//
+// Old snapshots are reclaimed with epoch-based reclamation: read() pins an
+// epoch for the duration of the callback, and a snapshot replaced by
+// publish() is freed by a later publish() once no reader still pins it.
+//
+// publish() must be called from one thread at a time; read() from any.
+class SnapshotStore {
+public:
+    explicit SnapshotStore(const NodeTable &table) : table(table) {}
+    ~SnapshotStore(); // no reader may be inside read()
+
+    SnapshotStore(const SnapshotStore &) = delete;
+    SnapshotStore &operator=(const SnapshotStore &) = delete;
+
+    // Snapshots the table as of `now` and makes it the current one
+    void publish(int64_t now);
+
+    // Calls fn(const ClusterSnapshot &) with the current snapshot. Returns
+    // false without calling fn if nothing was published yet.
+    template <typename Fn>
+    bool read(Fn fn) const {
+        EpochDomain::Guard guard(epochs);
+        const ClusterSnapshot *snapshot = current.load(std::memory_order_acquire);
+        if (!snapshot) return false;
+        fn(*snapshot);
+        return true;
+    }
+
+    SnapshotStats stats() const;
+
+private:
+    const NodeTable &table;
+    std::atomic<ClusterSnapshot *> current{nullptr};
+    mutable EpochDomain epochs;
+    std::atomic<uint64_t> published{0};
+    std::atomic<uint64_t> freed{0};
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef COMMAND_HPP
+#define COMMAND_HPP
+
+#include "protocol.hpp"
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+
+// ----------------------------------------------------
+// Text protocol helpers shared by the manager and the relay
+// ----------------------------------------------------
+
+// Strips surrounding whitespace from a protocol line
+inline std::string_view trim(std::string_view line) {
+    size_t first = line.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) return {};
+    return line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+}
+
+// A protocol line split into its verb and (trimmed) argument
+struct Command {
+    std::string_view verb;
+    std::string_view arg;
+};
+
+// Splits a line at verb_len, the first space as found by the scanner.
+// Lines with leading whitespace are rare and are re-split after trimming.
+inline Command splitCommand(std::string_view line, size_t verb_len) {
+    if (!line.empty() && (line[0] == ' ' || line[0] == '\t' || line[0] == '\r')) {
+        line = trim(line);
+        verb_len = std::min(line.find(' '), line.size());
+    }
+    if (verb_len >= line.size()) return {trim(line), {}};
+    return {line.substr(0, verb_len), trim(line.substr(verb_len + 1))};
+}
+
+// Parses the handle in "HB <handle>"; NO_HANDLE if there is none
+inline uint32_t parseHandle(std::string_view text) {
+    uint32_t handle = NO_HANDLE;
+    std::from_chars(text.data(), text.data() + text.size(), handle);
+    return handle;
+}
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef CORO_TASK_HPP
+#define CORO_TASK_HPP
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <new>
+
+// ----------------------------------------------------
+// Pooled allocator for coroutine frames
+//
+// Connection coroutines are created and destroyed with every worker
+// connection, so their frames are recycled through per-thread free lists
+// in 64-byte size classes instead of going through malloc. Blocks are
+// carved from chunks that are never returned, which keeps reconnect churn
+// from fragmenting the heap. A frame freed on another thread simply joins
+// that thread's list.
+// ----------------------------------------------------
+class FramePool {
+public:
+    static const size_t CLASS_SIZE = 64;
+    static const size_t MAX_POOLED = 1024; // larger frames go to operator new
+    static const size_t BLOCKS_PER_CHUNK = 64;
+
+    static void *allocate(size_t n) {
+        if (n > MAX_POOLED) return ::operator new(n);
+        FreeBlock *&head = freeList(n);
+        if (!head) refill(n);
+        FreeBlock *block = head;
+        head = block->next;
+        live_frames.fetch_add(1, std::memory_order_relaxed);
+        return block;
+    }
+
+    static void release(void *p, size_t n) {
+        if (n > MAX_POOLED) return ::operator delete(p);
+        FreeBlock *&head = freeList(n);
+        FreeBlock *block = (FreeBlock *)p;
+        block->next = head;
+        head = block;
+        live_frames.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    static size_t liveFrames() { return live_frames.load(std::memory_order_relaxed); }
+    static size_t reservedBytes() { return reserved_bytes.load(std::memory_order_relaxed); }
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    static size_t classOf(size_t n) { return (n + CLASS_SIZE - 1) / CLASS_SIZE; }
+
+    static FreeBlock *&freeList(size_t n) {
+        thread_local FreeBlock *lists[MAX_POOLED / CLASS_SIZE + 1] = {};
+        return lists[classOf(n)];
+    }
+
+    static void refill(size_t n) {
+        size_t block_size = classOf(n) * CLASS_SIZE;
+        char *chunk = (char *)std::malloc(block_size * BLOCKS_PER_CHUNK);
+        if (!chunk) throw std::bad_alloc();
+        reserved_bytes.fetch_add(block_size * BLOCKS_PER_CHUNK, std::memory_order_relaxed);
+        FreeBlock *&head = freeList(n);
+        for (size_t i = BLOCKS_PER_CHUNK; i-- > 0;) {
+            FreeBlock *block = (FreeBlock *)(chunk + i * block_size);
+            block->next = head;
+            head = block;
+        }
+    }
+
+    static inline std::atomic<size_t> live_frames{0};
+    static inline std::atomic<size_t> reserved_bytes{0};
+};
+
+// ----------------------------------------------------
+// Owning handle to a fire-and-forget coroutine. It starts running as soon
+// as it is called, stays suspended at its end until the Task is destroyed,
+// and draws its frame from FramePool.
+// ----------------------------------------------------
+class Task {
+public:
+    struct promise_type {
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { std::terminate(); }
+
+        static void *operator new(size_t n) { return FramePool::allocate(n); }
+        static void operator delete(void *p, size_t n) { FramePool::release(p, n); }
+    };
+
+    Task() = default;
+    Task(Task &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Task &operator=(Task &&other) noexcept {
+        if (this != &other) {
+            if (handle) handle.destroy();
+            handle = other.handle;
+            other.handle = nullptr;
+        }
+        return *this;
+    }
+    ~Task() {
+        if (handle) handle.destroy();
+    }
+
+    explicit operator bool() const { return (bool)handle; }
+    bool done() const { return !handle || handle.done(); }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : handle(h) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+#endif
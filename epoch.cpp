@@ -0,0 +1,60 @@
+// epoch.cpp
+#include "epoch.hpp"
+#include <algorithm>
+#include <thread>
+
+EpochDomain::Guard::Guard(EpochDomain &domain) : domain(domain) {
+    for (slot = 0;; slot = (slot + 1) % MAX_READERS) {
+        if (slot == 0 && domain.slots[MAX_READERS - 1].claimed.load(std::memory_order_relaxed)) {
+            std::this_thread::yield(); // every slot was busy on the last lap
+        }
+        bool expected = false;
+        if (domain.slots[slot].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) break;
+    }
+    // The pin must be visible before the reader loads any pointer; pairs
+    // with the fence in reclaim()
+    domain.slots[slot].pinned.store(domain.epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+EpochDomain::Guard::~Guard() {
+    domain.slots[slot].pinned.store(0, std::memory_order_release);
+    domain.slots[slot].claimed.store(false, std::memory_order_release);
+}
+
+EpochDomain::~EpochDomain() {
+    for (const Retired &r : retired) r.deleter(r.object);
+}
+
+// Called after the object was unpublished, so a reader that pins later
+// cannot reach it
+void EpochDomain::retire(void *object, void (*deleter)(void *)) {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    retired.push_back(Retired{epoch.load(std::memory_order_relaxed), object, deleter});
+}
+
+size_t EpochDomain::reclaim() {
+    std::vector<Retired> freeable;
+    {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = UINT64_MAX;
+        for (const Slot &slot : slots) {
+            uint64_t pinned = slot.pinned.load(std::memory_order_acquire);
+            if (pinned) oldest = std::min(oldest, pinned);
+        }
+        // Readers pinned at epoch e may hold anything retired in e or later
+        auto keep = std::partition(retired.begin(), retired.end(),
+                                   [oldest](const Retired &r) { return r.epoch >= oldest; });
+        freeable.assign(keep, retired.end());
+        retired.erase(keep, retired.end());
+        epoch.fetch_add(1, std::memory_order_relaxed);
+    }
+    for (const Retired &r : freeable) r.deleter(r.object);
+    return freeable.size();
+}
+
+size_t EpochDomain::pending() const {
+    std::lock_guard<std::mutex> lock(retired_mutex);
+    return retired.size();
+}
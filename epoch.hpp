@@ -0,0 +1,72 @@
+#ifndef EPOCH_HPP
+#define EPOCH_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Epoch-based reclamation for objects that readers reach through an
+// atomic pointer.
+//
+// A reader pins the current epoch for as long as it uses what it loaded.
+// A writer that unpublishes an object retires it instead of deleting it;
+// reclaim() frees it once every reader pinned at or before the epoch it
+// was retired in has unpinned. Readers never wait for writers and writers
+// never wait for readers: a slow reader only delays the free.
+//
+// Pinning claims one of MAX_READERS slots, so at most that many threads
+// can hold a pin at once; a further pin() spins until a slot frees up.
+class EpochDomain {
+public:
+    static const int MAX_READERS = 64;
+
+    // Keeps the epoch pinned until destroyed
+    class Guard {
+    public:
+        explicit Guard(EpochDomain &domain);
+        ~Guard();
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        EpochDomain &domain;
+        int slot;
+    };
+
+    EpochDomain() = default;
+    ~EpochDomain(); // frees everything still retired; no reader may be pinned
+
+    EpochDomain(const EpochDomain &) = delete;
+    EpochDomain &operator=(const EpochDomain &) = delete;
+
+    template <typename T>
+    void retire(T *object) {
+        retire(object, [](void *p) { delete static_cast<T *>(p); });
+    }
+    void retire(void *object, void (*deleter)(void *));
+
+    // Frees every retired object no pinned reader can still hold and
+    // advances the epoch. Returns how many were freed.
+    size_t reclaim();
+
+    size_t pending() const; // retired, not yet freed
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<bool> claimed{false};
+        std::atomic<uint64_t> pinned{0}; // epoch, 0 when not pinned
+    };
+    struct Retired {
+        uint64_t epoch;
+        void *object;
+        void (*deleter)(void *);
+    };
+
+    std::atomic<uint64_t> epoch{1};
+    Slot slots[MAX_READERS];
+    mutable std::mutex retired_mutex;
+    std::vector<Retired> retired;
+};
+
+#endif
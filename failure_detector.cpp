@@ -0,0 +1,114 @@
+// failure_detector.cpp
+#include "failure_detector.hpp"
+#include <algorithm>
+
+static uint32_t blockKey(uint32_t shard, uint32_t block) {
+    return shard * NodeTable::MAX_BLOCKS + block;
+}
+
+FailureDetector::FailureDetector(NodeTable &table, int64_t suspect_ns, int64_t fail_ns, int64_t now)
+    : table(table), suspect_ns(suspect_ns), fail_ns(fail_ns), wheel(WHEEL_SLOTS),
+      current_tick(now / TICK_NS - 1), armed_at(NodeTable::MAX_SHARDS * NodeTable::MAX_BLOCKS, 0) {
+    subscription = table.subscribe([this](const NodeEvent &event) {
+        if (event.to != NodeStatus::Active && event.to != NodeStatus::Joining) return;
+        Entry entry{blockKey(NodeTable::shardOf(event.handle), NodeTable::blockOfHandle(event.handle)),
+                    deadlineOf(event.to, event.at)};
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending.push_back(entry);
+    });
+    // Loaded state: scan everything on the first tick
+    for (uint32_t s = 0; s < table.shardCount(); s++) {
+        for (uint32_t b = 0; b < table.blockCount(s); b++) arm(blockKey(s, b), 0);
+    }
+}
+
+FailureDetector::~FailureDetector() {
+    table.unsubscribe(subscription);
+}
+
+// 0 if the node cannot time out
+int64_t FailureDetector::deadlineOf(NodeStatus status, int64_t last_seen) const {
+    if (last_seen == OldestSeen::NO_NODE) return 0;
+    switch (status) {
+        case NodeStatus::Active: return last_seen + suspect_ns;
+        case NodeStatus::Joining:
+        case NodeStatus::Suspect: return last_seen + fail_ns;
+        default: return 0;
+    }
+}
+
+// Files a deadline unless the block already has an earlier one. A later
+// entry left behind is dropped when its slot comes up.
+void FailureDetector::arm(uint32_t block, int64_t deadline) {
+    deadline = std::max(deadline, (current_tick + 1) * TICK_NS);
+    int64_t &armed_deadline = armed_at[block];
+    if (armed_deadline != 0 && armed_deadline <= deadline) return;
+    if (armed_deadline == 0) armed++;
+    armed_deadline = deadline;
+    wheel[(deadline / TICK_NS) % WHEEL_SLOTS].push_back(Entry{block, deadline});
+}
+
+void FailureDetector::armPending() {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        entries.swap(pending);
+    }
+    for (const Entry &entry : entries) arm(entry.block, entry.deadline);
+}
+
+void FailureDetector::runSlot(uint32_t slot, int64_t now, size_t &changed) {
+    due.clear();
+    due.swap(wheel[slot]);
+
+    for (const Entry &entry : due) {
+        int64_t &armed_deadline = armed_at[entry.block];
+        if (armed_deadline != entry.deadline) continue; // superseded by an earlier one
+        if (entry.deadline > now) {
+            wheel[slot].push_back(entry); // due on a later turn
+            continue;
+        }
+        armed_deadline = 0;
+        armed--;
+
+        OldestSeen oldest;
+        size_t n = table.expireBlock(entry.block / NodeTable::MAX_BLOCKS, entry.block % NodeTable::MAX_BLOCKS,
+                                     now - suspect_ns, now - fail_ns, now, oldest);
+        scans++;
+        transitions += n;
+        changed += n;
+
+        int64_t next_active = deadlineOf(NodeStatus::Active, oldest.active);
+        int64_t next_waiting = deadlineOf(NodeStatus::Suspect, oldest.waiting);
+        int64_t next = next_active && next_waiting ? std::min(next_active, next_waiting)
+                                                   : std::max(next_active, next_waiting);
+        if (next) arm(entry.block, next);
+    }
+}
+
+// A tick is run once it has fully passed, so everything filed in it is due
+// (or belongs to a later turn)
+size_t FailureDetector::advance(int64_t now) {
+    armPending();
+    size_t changed = 0;
+    int64_t last_tick = now / TICK_NS - 1;
+    // After a stall longer than a turn every slot is due once
+    int64_t first = std::max(current_tick + 1, last_tick - (int64_t)WHEEL_SLOTS + 1);
+    for (int64_t tick = first; tick <= last_tick; tick++) {
+        current_tick = tick;
+        runSlot(tick % WHEEL_SLOTS, now, changed);
+    }
+    current_tick = std::max(current_tick, last_tick);
+    return changed;
+}
+
+int64_t FailureDetector::nextDeadline(int64_t now) const {
+    for (int64_t tick = current_tick + 1; tick <= current_tick + WHEEL_SLOTS; tick++) {
+        if (!wheel[tick % WHEEL_SLOTS].empty()) return (tick + 1) * TICK_NS;
+    }
+    return now + WHEEL_SLOTS * TICK_NS;
+}
+
+DetectorStats FailureDetector::stats() const {
+    return DetectorStats{armed, scans, transitions};
+}
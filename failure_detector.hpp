@@ -0,0 +1,90 @@
+#ifndef FAILURE_DETECTOR_HPP
+#define FAILURE_DETECTOR_HPP
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include "node_table.hpp"
+
+struct DetectorStats {
+    size_t armed;         // record blocks with a deadline on the wheel
+    uint64_t scans;       // blocks scanned because their deadline came due
+    uint64_t transitions; // status changes those scans made
+};
+
+// Deadline-driven failure detection over a NodeTable.
+//
+// Every record block that holds a node which can still time out (joining,
+// active or suspect) has one deadline on a hashed timing wheel of
+// WHEEL_SLOTS slots, TICK_NS each: the earliest deadline of any node in
+// it, i.e. last_seen plus the timeout for that node's status. advance()
+// only visits the slots that came due since the previous call and scans
+// the blocks in them, so a node times out within a tick of its deadline
+// and the monitor can sleep until nextDeadline() in between.
+//
+// Heartbeats do not touch the wheel, so touch() stays a lock-free store.
+// Instead deadlines move lazily: a due block is scanned, the nodes that
+// really timed out change status, and the block is filed again at the
+// new earliest deadline. With regular heartbeats each block is scanned
+// about once per (suspect timeout - heartbeat interval), a sequential
+// pass over its last_seen array. Blocks gaining a node that can time out
+// (a join, or a failed node coming back) are picked up through the
+// table's transition events.
+//
+// advance(), nextDeadline() and stats() must be called from one thread
+// (the monitor). Times are LivenessClock nanoseconds.
+class FailureDetector {
+public:
+    static const int64_t TICK_NS = 50000000; // 50 ms
+    static const uint32_t WHEEL_SLOTS = 512; // one turn covers 25.6 s
+
+    // Subscribes to the table and arms every block already in it. Create
+    // it before the table is shared, like any other subscriber, and
+    // destroy it (which unsubscribes) only when it is no longer shared.
+    FailureDetector(NodeTable &table, int64_t suspect_ns, int64_t fail_ns, int64_t now);
+    ~FailureDetector();
+
+    FailureDetector(const FailureDetector &) = delete;
+    FailureDetector &operator=(const FailureDetector &) = delete;
+
+    // Runs every deadline due at or before now. Returns the number of
+    // transitions it caused.
+    size_t advance(int64_t now);
+
+    // End of the earliest tick with a deadline filed, when advance() will
+    // run it, or a full turn after now if the wheel is empty
+    int64_t nextDeadline(int64_t now) const;
+
+    DetectorStats stats() const;
+
+private:
+    // A block is identified by shard * MAX_BLOCKS + block
+    struct Entry {
+        uint32_t block;
+        int64_t deadline;
+    };
+
+    int64_t deadlineOf(NodeStatus status, int64_t last_seen) const;
+    void arm(uint32_t block, int64_t deadline);
+    void runSlot(uint32_t slot, int64_t now, size_t &changed);
+    void armPending();
+
+    NodeTable &table;
+    uint64_t subscription;
+    int64_t suspect_ns;
+    int64_t fail_ns;
+
+    std::vector<std::vector<Entry>> wheel;
+    std::vector<Entry> due;          // scratch for runSlot()
+    int64_t current_tick;            // last tick advance() ran; the next one is still open
+    std::vector<int64_t> armed_at;   // per block: its live deadline, 0 if none
+    size_t armed = 0;
+    uint64_t scans = 0;
+    uint64_t transitions = 0;
+
+    // Deadlines from transition events, from whichever thread saw them
+    std::mutex pending_mutex;
+    std::vector<Entry> pending;
+};
+
+#endif
@@ -0,0 +1,102 @@
+// heartbeat_board.cpp
+#include "heartbeat_board.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static size_t boardBytes(uint32_t slots) {
+    return sizeof(BoardHeader) + (size_t)slots * sizeof(BoardSlot);
+}
+
+bool HeartbeatBoard::map(int fd, size_t bytes) {
+    void *p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return false;
+    header = (BoardHeader *)p;
+    slots = (BoardSlot *)((char *)p + sizeof(BoardHeader));
+    mapped_bytes = bytes;
+    return true;
+}
+
+HeartbeatBoard::HeartbeatBoard(const std::string &name, uint32_t slot_count) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0660);
+    if (fd < 0) return;
+
+    // Reuse a board of the same shape; anything else is rebuilt from zero
+    struct stat st{};
+    size_t bytes = boardBytes(slot_count);
+    bool reuse = fstat(fd, &st) == 0 && (size_t)st.st_size == bytes;
+    if (!reuse && (ftruncate(fd, 0) < 0 || ftruncate(fd, bytes) < 0)) {
+        close(fd);
+        return;
+    }
+    bool mapped = map(fd, bytes);
+    close(fd);
+    if (!mapped) return;
+
+    if (reuse && header->magic.load(std::memory_order_acquire) == BOARD_MAGIC &&
+        header->version == BOARD_VERSION && header->slot_count == slot_count) {
+        return;
+    }
+    memset((void *)header, 0, bytes);
+    header->version = BOARD_VERSION;
+    header->slot_count = slot_count;
+    header->magic.store(BOARD_MAGIC, std::memory_order_release);
+}
+
+HeartbeatBoard::HeartbeatBoard(const std::string &name) {
+    int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) return;
+
+    struct stat st{};
+    bool mapped = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(BoardHeader) &&
+                  map(fd, st.st_size);
+    close(fd);
+    if (!mapped) return;
+
+    // Not initialised yet, or a layout we do not understand
+    if (header->magic.load(std::memory_order_acquire) != BOARD_MAGIC ||
+        header->version != BOARD_VERSION ||
+        boardBytes(header->slot_count) > mapped_bytes) {
+        munmap(header, mapped_bytes);
+        header = nullptr;
+        slots = nullptr;
+    }
+}
+
+HeartbeatBoard::~HeartbeatBoard() {
+    if (header) munmap(header, mapped_bytes);
+}
+
+BoardSlot *HeartbeatBoard::claim(std::string_view id) {
+    if (id.empty() || id.size() > MAX_ID) return nullptr;
+
+    uint32_t used = header->used.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < used; i++) {
+        BoardSlot &slot = slots[i];
+        if (slot.state.load(std::memory_order_acquire) == SLOT_CLAIMED &&
+            std::string_view(slot.id, strnlen(slot.id, MAX_ID)) == id) {
+            return &slot;
+        }
+    }
+
+    for (uint32_t i = 0; i < header->slot_count; i++) {
+        BoardSlot &slot = slots[i];
+        uint32_t expected = SLOT_FREE;
+        if (!slot.state.compare_exchange_strong(expected, SLOT_CLAIMING, std::memory_order_acq_rel)) {
+            continue;
+        }
+        memset(slot.id, 0, sizeof(slot.id));
+        memcpy(slot.id, id.data(), id.size());
+        slot.seq.store(0, std::memory_order_relaxed);
+        slot.beat_ns.store(0, std::memory_order_relaxed);
+        slot.state.store(SLOT_CLAIMED, std::memory_order_release);
+
+        // Let the scanner see this slot
+        uint32_t hwm = header->used.load(std::memory_order_relaxed);
+        while (hwm < i + 1 &&
+               !header->used.compare_exchange_weak(hwm, i + 1, std::memory_order_release)) {}
+        return &slot;
+    }
+    return nullptr;
+}
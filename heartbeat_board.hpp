@@ -0,0 +1,100 @@
+#ifndef HEARTBEAT_BOARD_HPP
+#define HEARTBEAT_BOARD_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+// ----------------------------------------------------
+// Shared-memory heartbeat board for same-host workers
+//
+// The manager creates a POSIX shared memory region holding a header and a
+// fixed array of cache-line slots. A worker claims one slot for its node ID
+// and from then on a heartbeat is two stores into its own line: no
+// syscalls, no messages, and no line shared with another writer. The
+// manager's monitor scans the claimed slots and treats a changed timestamp
+// as a heartbeat.
+//
+// Timestamps are CLOCK_MONOTONIC nanoseconds, which all processes on the
+// host share. Slots are never released, like records in the node table, so
+// a restarted worker finds and reuses its old slot. The region outlives the
+// manager, which lets a backup on the same host pick up where it left off.
+// ----------------------------------------------------
+
+const uint32_t BOARD_MAGIC = 0x48424244; // "DBBH"
+const uint32_t BOARD_VERSION = 1;
+
+enum SlotState : uint32_t {
+    SLOT_FREE = 0,
+    SLOT_CLAIMING = 1, // a worker is writing the ID
+    SLOT_CLAIMED = 2,
+};
+
+struct alignas(64) BoardSlot {
+    std::atomic<uint32_t> state;
+    uint32_t reserved;
+    std::atomic<uint64_t> seq;     // bumped on every heartbeat
+    std::atomic<uint64_t> beat_ns; // CLOCK_MONOTONIC at the last heartbeat
+    char id[40];                   // NUL-terminated node ID
+};
+static_assert(sizeof(BoardSlot) == 64, "one slot per cache line");
+
+struct alignas(64) BoardHeader {
+    std::atomic<uint32_t> magic; // written last, once the header is valid
+    uint32_t version;
+    uint32_t slot_count;
+    std::atomic<uint32_t> used;  // high-water mark of claimed slots
+};
+static_assert(sizeof(BoardHeader) == 64, "slots start on a cache line");
+
+class HeartbeatBoard {
+public:
+    static const uint32_t DEFAULT_SLOTS = 65536;
+    static const size_t MAX_ID = sizeof(BoardSlot::id) - 1;
+
+    // Manager side: creates the region, or reuses a valid one left behind
+    // by an earlier manager so that workers already attached keep working.
+    HeartbeatBoard(const std::string &name, uint32_t slots);
+    // Worker side: maps a region the manager has already created
+    explicit HeartbeatBoard(const std::string &name);
+    ~HeartbeatBoard();
+
+    HeartbeatBoard(const HeartbeatBoard &) = delete;
+    HeartbeatBoard &operator=(const HeartbeatBoard &) = delete;
+
+    bool ok() const { return header != nullptr; }
+    uint32_t slotCount() const { return header->slot_count; }
+
+    // Returns this node's slot, claiming a free one if it has none yet.
+    // nullptr if the ID is too long or the board is full.
+    BoardSlot *claim(std::string_view id);
+
+    static void beat(BoardSlot *slot, uint64_t now_ns) {
+        slot->seq.fetch_add(1, std::memory_order_relaxed);
+        slot->beat_ns.store(now_ns, std::memory_order_release);
+    }
+
+    // Calls fn(index, id, seq, beat_ns) for every claimed slot
+    template <typename Fn>
+    void forEachClaimed(Fn &&fn) const {
+        uint32_t used = header->used.load(std::memory_order_acquire);
+        for (uint32_t i = 0; i < used; i++) {
+            const BoardSlot &slot = slots[i];
+            if (slot.state.load(std::memory_order_acquire) != SLOT_CLAIMED) continue;
+            uint64_t beat_ns = slot.beat_ns.load(std::memory_order_acquire);
+            fn(i, std::string_view(slot.id, strnlen(slot.id, MAX_ID)),
+               slot.seq.load(std::memory_order_relaxed), beat_ns);
+        }
+    }
+
+private:
+    bool map(int fd, size_t bytes);
+
+    BoardHeader *header = nullptr;
+    BoardSlot *slots = nullptr;
+    size_t mapped_bytes = 0;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LINE_FRAMER_HPP
+#define LINE_FRAMER_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include "text_scanner.hpp"
+
+// Streaming splitter for the newline-delimited text protocol.
+//
+// Complete lines are handed out as views straight into the caller's receive
+// buffer, so nothing is copied or allocated on the common path. Only a line
+// that straddles two reads is copied into the small inline carry buffer and
+// stitched together when the rest arrives. Lines are found in batches by
+// the vectorised scanner, which also reports where each verb ends.
+class LineFramer {
+public:
+    static const size_t MAX_LINE = 256; // longest line a peer may send
+
+    // Calls on_line(std::string_view line, size_t verb_len) for every
+    // complete line in data, without the trailing '\n'. verb_len is the
+    // offset of the first space, or the line length if there is none.
+    // Returns false if a line exceeds MAX_LINE, in which case the stream
+    // cannot be resynchronised and should be closed.
+    template <typename Fn>
+    bool feed(const char *data, size_t len, Fn &&on_line) {
+        const char *p = data;
+        const char *end = data + len;
+
+        if (carry_len > 0) {
+            const char *nl = (const char *)memchr(p, '\n', len);
+            size_t take = nl ? (size_t)(nl - p) : len;
+            if (carry_len + take > MAX_LINE) return false;
+            memcpy(carry + carry_len, p, take);
+            carry_len += take;
+            if (!nl) return true;
+            const char *sp = (const char *)memchr(carry, ' ', carry_len);
+            on_line(std::string_view(carry, carry_len), sp ? (size_t)(sp - carry) : carry_len);
+            carry_len = 0;
+            p = nl + 1;
+        }
+
+        LineSpan spans[SCAN_BATCH];
+        while (p < end) {
+            size_t consumed;
+            size_t n = scanLines(p, end - p, spans, SCAN_BATCH, consumed);
+            for (size_t i = 0; i < n; i++) {
+                on_line(std::string_view(p + spans[i].begin, spans[i].end - spans[i].begin),
+                        spans[i].verb_end - spans[i].begin);
+            }
+            p += consumed;
+            if (n < SCAN_BATCH) break;
+        }
+
+        size_t rest = end - p;
+        if (rest > MAX_LINE) return false;
+        memcpy(carry, p, rest);
+        carry_len = (uint16_t)rest;
+        return true;
+    }
+
+    size_t buffered() const { return carry_len; }
+
+private:
+    static const size_t SCAN_BATCH = 128; // spans per scanner call
+
+    uint16_t carry_len = 0;
+    char carry[MAX_LINE];
+};
+
+#endif
@@ -1,17 +1,36 @@
 #include <iostream>
 #include <thread>
-#include <map>
+#include <charconv>
+#include <string_view>
+#include <vector>
+#include <algorithm>
 #include <mutex>
+#include <condition_variable>
+#include <utility>
+#include <atomic>
 #include <chrono>
 #include <cstring>
+#include <cerrno>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fstream>
+#include <sstream>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <sys/un.h>
 #include <csignal>
 #include "logger.hpp"
+#include "reactor.hpp"
+#include "command.hpp"
+#include "stats.hpp"
+#include "node_table.hpp"
+#include "failure_detector.hpp"
+#include "clock.hpp"
+#include "cluster_snapshot.hpp"
+#include "applier_pool.hpp"
+#include "heartbeat_board.hpp"
+#include "udp_listener.hpp"
 #include "include/json.hpp"
 #include <csignal>
 
@@ -29,173 +48,911 @@ void signalHandler(int signum) {
 }
 using json = nlohmann::json;
 
-struct NodeInfo {
-    time_t last_seen;
-    std::string status;
-};
-
-std::map<std::string, NodeInfo> cluster;
-std::mutex cluster_mutex;
+NodeTable cluster;
+SnapshotStore snapshots(cluster); // published by the monitor for display and persistence
+StripedCounter heartbeats_received;
 
 const int PORT = 5050;
-const int TIMEOUT = 11; // seconds
 const int DISPLAY_INTERVAL = 10; // seconds
+const int HOUSEKEEPING_MS = 2000; // storm progress, display and persistence; the board may scan more often
 time_t last_display_time = 0;
 
+// Set by transition events; the monitor redraws on its next pass instead
+// of waiting for DISPLAY_INTERVAL
+std::atomic<bool> display_pending{false};
+
+const char* USAGE = "Usage: ./manager [primary|backup] [options]\n"
+                    "  --reactors N          event loop threads, each with its own listener (default 1)\n"
+                    "  --backend B           auto, epoll or uring (default auto)\n"
+                    "  --udp                 also accept HEARTBEAT datagrams on the TCP port\n"
+                    "  --unix PATH           also listen on an AF_UNIX socket for same-host workers\n"
+                    "  --shm NAME            also scan a shared-memory heartbeat board\n"
+                    "  --appliers N          apply heartbeats on N threads so the reactors only parse them (default 0: inline)\n"
+                    "  --storm               summarise REGISTERs instead of logging each one; implies\n"
+                    "                        --backlog 65535 --admit-rate 20000 unless they are given\n"
+                    "  --backlog N           listen() backlog (default SOMAXCONN)\n"
+                    "  --admit-rate N        REGISTERs admitted per second (default 0: all)\n"
+                    "  --timeout-ms N        silence before a node fails; suspect at 5/11 of it (default 11000)\n"
+                    "  --max-nodes N         preallocate the node table for N nodes\n"
+                    "  --hugepages           back slab chunks with 2 MB huge pages";
+const size_t HEARTBEAT_QUEUE_CAPACITY = 65536;
+const size_t CHANGES_CHUNK = 64 * 1024; // CHANGES replies are written in pieces of about this size
+const size_t DISPLAY_CHUNK = 64 * 1024; // the display is printed in pieces of about this size
+
+// Command line options
+struct ManagerOptions {
+    int reactors = 1; // event loop threads, each with its own listening socket
+    Backend backend = Backend::Auto;
+    bool udp = false; // also accept HEARTBEAT datagrams on PORT
+    int appliers = 0; // threads applying queued heartbeats off the reactors; 0 applies them inline
+    std::string unix_path; // also listen on this AF_UNIX socket for same-host workers
+    std::string shm_name;  // also scan this shared-memory heartbeat board
+    int backlog = SOMAXCONN; // listen() backlog; the kernel caps it at net.core.somaxconn
+    int admit_rate = 0;      // REGISTERs admitted per second; 0 admits all
+    bool storm = false;      // summarise REGISTERs instead of logging each one
+    int timeout_ms = 11000;  // silence before a node fails
+    int suspect_ms = 5000;   // silence before it is suspect: 5/11 of timeout_ms
+    long max_nodes = 0;      // expected cluster size, preallocated at startup; 0 grows on demand
+};
+ManagerOptions options;
+
+// Set when options.appliers > 0
+std::unique_ptr<ApplierPool> applier_pool;
+
+// Owned by the monitor thread once the server starts
+std::unique_ptr<FailureDetector> detector;
+
+// Set when options.shm_name is given. Only the monitor thread touches the
+// per-slot bookkeeping.
+std::unique_ptr<HeartbeatBoard> board;
+std::vector<uint64_t> board_last_beat; // beat_ns seen at the previous scan
+std::vector<uint32_t> board_handles;   // node handle for each slot
+
 Logger logger("manager.log");
 
 // ----------------------------------------------------
 // Persist and load cluster state
+//
+// cluster_state.json is a full checkpoint and cluster_state.journal has
+// one line per node change since, so a pass only costs as much as the
+// churn since the previous one. Once the journal has more lines than the
+// cluster has nodes, the pass writes a fresh checkpoint and empties it.
+// Only changes are written, so a stored last_seen is as old as the node's
+// last status change. Only the reporter thread persists.
+//
+// cluster_state.tag holds the handle tag of the last manager instance to
+// load the state, see claimHandleTag().
 // ----------------------------------------------------
-void persistClusterState() {
-    json j;
+const char *STATE_FILE = "cluster_state.json";
+const char *JOURNAL_FILE = "cluster_state.journal";
+const char *TAG_FILE = "cluster_state.tag";
+uint64_t persisted_epoch = 0; // change epoch the files are current to
+size_t journal_lines = 0;
+
+json nodeState(const NodeView &node) {
+    return {
+        {"status", statusName(node.status)},
+        {"last_seen", LivenessClock::toWall(node.last_seen)},
+        {"since", LivenessClock::toWall(node.since)}
+    };
+}
+
+// Streamed one node per line rather than built as one json document, so
+// a checkpoint of a million nodes never holds more than a line in memory
+void writeCheckpoint() {
+    std::string tmp = std::string(STATE_FILE) + ".tmp";
     {
-        std::lock_guard<std::mutex> lock(cluster_mutex);
-        for (auto &p : cluster) {
-            j[p.first] = {
-                {"status", p.second.status},
-                {"last_seen", p.second.last_seen}
-            };
+        std::ofstream file(tmp);
+        const char *separator = "{\n";
+        cluster.forEach([&file, &separator](const NodeView &node) {
+            file << separator << "    " << json(std::string(node.id)).dump() << ": " << nodeState(node).dump();
+            separator = ",\n";
+        });
+        file << (*separator == '{' ? "{}\n" : "\n}\n");
+    }
+    rename(tmp.c_str(), STATE_FILE);
+    std::ofstream(JOURNAL_FILE, std::ios::trunc);
+    journal_lines = 0;
+}
+
+void persistClusterState() {
+    std::vector<uint32_t> changed;
+    persisted_epoch = cluster.changedSince(persisted_epoch, changed);
+    if (changed.empty()) return;
+    // >=: the first pass after startup sees every node as changed, and a
+    // full set of changes belongs in a checkpoint, not the journal
+    bool checkpoint = journal_lines + changed.size() >= cluster.size();
+    // Journaled even when a checkpoint follows, unless the journal is
+    // empty: older lines must not be replayed over the newer checkpoint if
+    // the manager dies before truncating the journal
+    if (!checkpoint || journal_lines > 0) {
+        std::ofstream journal(JOURNAL_FILE, std::ios::app);
+        NodeView node;
+        for (uint32_t handle : changed) {
+            if (!cluster.read(handle, node)) continue;
+            json line = nodeState(node);
+            line["id"] = node.id;
+            journal << line.dump() << "\n";
         }
+        journal_lines += changed.size();
     }
-    std::ofstream file("cluster_state.json");
-    file << j.dump(4);
+    if (checkpoint) writeCheckpoint();
 }
 
-void loadClusterState() {
-    std::ifstream file("cluster_state.json");
-    if (!file.is_open()) return;
+// Stored as wall time; the table runs on the liveness clock. Live nodes
+// are stamped again when the server starts, see startReregistration().
+void loadNodeState(const std::string &node, const json &info) {
+    time_t last_seen = info["last_seen"];
+    NodeStatus status = parseStatus(info["status"].get<std::string>());
+    cluster.upsert(node, LivenessClock::fromWall(last_seen), status,
+                   LivenessClock::fromWall(info.value("since", last_seen)));
+}
+
+// Takes the handle tag after the previous instance's (a restarted
+// primary, or the primary a backup replaces) and records it at once, so
+// the next instance moves past it even if this one dies before persisting
+// anything. Handles from the previous instance are then always stale.
+void claimHandleTag() {
+    std::ifstream file(TAG_FILE);
+    uint32_t previous;
+    if (file >> previous) cluster.followTag(previous);
+    std::string tmp = std::string(TAG_FILE) + ".tmp";
+    {
+        std::ofstream out(tmp);
+        out << cluster.handleTag() << "\n";
+    }
+    rename(tmp.c_str(), TAG_FILE);
+}
+
+// One member line of a checkpoint as writeCheckpoint() writes it,
+// `"<id>": {...},`. Returns false for anything else.
+bool loadCheckpointLine(std::string_view line) {
+    if (!line.empty() && line.back() == ',') line.remove_suffix(1);
+    if (line.empty() || line.front() != '"') return false;
+    json member = json::parse("{" + std::string(line) + "}", nullptr, false);
+    if (member.is_discarded() || member.size() != 1) return false;
+    loadNodeState(member.begin().key(), member.begin().value());
+    return true;
+}
+
+// The checkpoint is read a line at a time like the journal, so loading a
+// million nodes never holds more than one of them as json. A checkpoint
+// in any other layout (pretty-printed by older versions, or written by
+// hand) is parsed as one document instead.
+void loadCheckpoint(std::ifstream &file) {
+    std::string line;
+    bool by_line = std::getline(file, line) && trim(line) == "{";
+    while (by_line && std::getline(file, line) && trim(line) != "}") {
+        by_line = loadCheckpointLine(trim(line));
+    }
+    if (by_line) return;
+    file.clear();
+    file.seekg(0);
     json j; file >> j;
-    for (auto &[node, info] : j.items()) {
-        cluster[node] = {info["last_seen"], info["status"]};
+    for (auto &[node, info] : j.items()) loadNodeState(node, info);
+}
+
+void loadClusterState() {
+    claimHandleTag();
+    std::ifstream file(STATE_FILE);
+    std::ifstream journal(JOURNAL_FILE);
+    if (!file.is_open() && !journal.is_open()) return;
+    if (file.is_open()) loadCheckpoint(file);
+    // Later lines win
+    std::string line;
+    while (std::getline(journal, line)) {
+        json info = json::parse(line, nullptr, false);
+        if (info.is_discarded() || !info.contains("id")) continue; // torn last line
+        loadNodeState(info["id"], info);
+        journal_lines++;
     }
     logger.info("Cluster state loaded from file.");
 }
 
+// ----------------------------------------------------
+// Storage occupancy for the status output, e.g. with prefix "slab_":
+// "slab_connections=12/163 slab_records=40/1092 slab_index=40/712 slab_huge_chunks=0"
+// ----------------------------------------------------
+std::string slabSummary(const std::string &prefix) {
+    SlabStats conns = connectionSlabStats();
+    SlabStats records = cluster.recordStats();
+    SlabStats index = cluster.indexStats();
+    auto fmt = [&prefix](const char *name, const SlabStats &s) {
+        return prefix + name + "=" + std::to_string(s.in_use) + "/" + std::to_string(s.capacity);
+    };
+    return fmt("connections", conns) + " " + fmt("records", records) + " " + fmt("index", index) +
+           " " + prefix + "huge_chunks=" +
+           std::to_string(conns.huge_chunks + records.huge_chunks + index.huge_chunks);
+}
+
 // ----------------------------------------------------
 // Display the current cluster state
 // ----------------------------------------------------
-void displayClusterState() {
-    std::lock_guard<std::mutex> lock(cluster_mutex);
-    std::cout << "\n=== Cluster State ===" << std::endl;
-    for (auto &p : cluster) {
-        std::string last_seen = std::string(ctime(&p.second.last_seen));
+void displayClusterState(const ClusterSnapshot &snapshot, const DetectorStats &d) {
+    // Formatted into a buffer that goes out every DISPLAY_CHUNK bytes:
+    // the terminal is far slower than walking the snapshot, but a large
+    // cluster is too big to format whole first
+    std::ostringstream out;
+    out << "\n=== Cluster State ===\n";
+    snapshot.forEach([&out](const NodeView &node) {
+        time_t seen_wall = LivenessClock::toWall(node.last_seen);
+        time_t since_wall = LivenessClock::toWall(node.since);
+        std::string last_seen = std::string(ctime(&seen_wall));
         if (!last_seen.empty() && last_seen.back() == '\n') {
             last_seen.pop_back();
         }
-        std::cout << p.first << " | " << p.second.status
-                  << " | Last seen: " << last_seen << std::endl;
+        char since[16];
+        strftime(since, sizeof(since), "%H:%M:%S", localtime(&since_wall));
+        out << node.id << " | " << statusName(node.status) << " since " << since
+            << " | Last seen: " << last_seen << "\n";
+        if (out.tellp() >= (std::streamoff)DISPLAY_CHUNK) {
+            std::cout << out.str();
+            out.str("");
+        }
+    });
+    if (applier_pool) {
+        ApplierStats s = applier_pool->stats();
+        out << "Heartbeat queue: depth " << s.queue_depth
+            << ", apply latency avg " << s.avg_latency_us << "us max " << s.max_latency_us
+            << "us, " << (s.batches ? s.events / s.batches : 0) << " per batch, "
+            << s.overflows << " overflowed\n";
+    }
+    out << "Failure detector: " << d.armed << " blocks armed, " << d.scans << " scans, "
+        << d.transitions << " transitions\n";
+    SnapshotStats snap = snapshots.stats();
+    out << "Snapshots: " << snap.published << " published, " << snap.freed << " freed, "
+        << snap.retired << " held by readers\n";
+    out << "Slabs: " << slabSummary("") << "\n";
+    out << "=====================\n";
+    std::cout << out.str() << std::endl;
+}
+
+// ----------------------------------------------------
+// Thread that displays and persists the cluster. The monitor publishes a
+// snapshot and requests a report; formatting and writing a large cluster
+// happens here, off the monitor, so failure detection and ingestion never
+// wait for it. Requests made while a report is running are merged into
+// the next one.
+// ----------------------------------------------------
+std::mutex report_mutex;
+std::condition_variable report_cv;
+bool report_display = false;
+bool report_persist = false;
+DetectorStats report_detector{}; // as of the latest display request
+
+void requestReport(bool display, bool persist, const DetectorStats &d) {
+    {
+        std::lock_guard<std::mutex> lock(report_mutex);
+        report_display |= display;
+        report_persist |= persist;
+        if (display) report_detector = d;
+    }
+    report_cv.notify_one();
+}
+
+void reportNodes() {
+    while (true) {
+        bool display, persist;
+        DetectorStats d;
+        {
+            std::unique_lock<std::mutex> lock(report_mutex);
+            report_cv.wait(lock, [] { return report_display || report_persist; });
+            display = std::exchange(report_display, false);
+            persist = std::exchange(report_persist, false);
+            d = report_detector;
+        }
+        if (display) snapshots.read([&d](const ClusterSnapshot &snapshot) { displayClusterState(snapshot, d); });
+        if (persist) persistClusterState();
+    }
+}
+
+// ----------------------------------------------------
+// Reconnect storm handling
+//
+// After a takeover every worker reconnects at once. Connections are
+// accepted as fast as they arrive so the kernel queue stays short, but
+// REGISTERs are admitted at options.admit_rate: a rejected worker is told
+// "RETRY <ms>" and comes back later. Admission is a GCRA token bucket that
+// allows a burst of ADMIT_BURST_MS worth of registrations.
+// ----------------------------------------------------
+const int64_t ADMIT_BURST_MS = 100;
+const int STORM_BACKLOG = 65535;
+const int STORM_ADMIT_RATE = 20000; // REGISTERs per second
+std::atomic<int64_t> admit_tat_ns{0}; // theoretical arrival time of the next REGISTER
+
+int64_t steadyNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Returns true if a REGISTER may proceed now; otherwise sets retry_ms
+bool admitRegistration(int64_t &retry_ms) {
+    if (options.admit_rate <= 0) return true;
+    int64_t interval = 1000000000LL / options.admit_rate;
+    int64_t burst = std::max<int64_t>(ADMIT_BURST_MS * 1000000, interval);
+    int64_t now = steadyNs();
+    int64_t tat = admit_tat_ns.load(std::memory_order_relaxed);
+    while (true) {
+        int64_t next = std::max(tat, now) + interval;
+        if (next - now > burst) {
+            retry_ms = (next - now - burst) / 1000000 + 1;
+            return false;
+        }
+        if (admit_tat_ns.compare_exchange_weak(tat, next, std::memory_order_relaxed)) return true;
+    }
+}
+
+// How long the nodes loaded from persisted state take to register again.
+// Only nodes that were live (joining, active or suspect) at the takeover
+// are waited for; the count closes once the timeout has passed, as any
+// node still missing has failed by then. Guarded by rereg_mutex.
+struct Reregistration {
+    std::chrono::steady_clock::time_point start;
+    std::vector<std::vector<bool>> seen; // by shard and index; loaded nodes come first, not awaited ones preset
+    size_t expected = 0;
+    size_t done = 0;
+    bool reported = false;
+};
+Reregistration rereg;
+std::mutex rereg_mutex;
+
+// A node restored live was seen at least at its last change and maybe
+// long after, so it gets a full timeout from the takeover to check in
+// (and, in storm mode, to wait for admission). Stamped here, once the
+// load is over: loading a large cluster takes long enough that a clock
+// read before it would fail them all on the first sweep.
+void startReregistration() {
+    int64_t now = LivenessClock::tick();
+    cluster.forEach([now](const NodeView &node) {
+        bool live = node.status == NodeStatus::Active || node.status == NodeStatus::Suspect ||
+                    node.status == NodeStatus::Joining;
+        if (live && node.last_seen < now) cluster.upsert(node.id, now, node.status, node.since);
+    });
+    std::lock_guard<std::mutex> lock(rereg_mutex);
+    rereg.start = std::chrono::steady_clock::now();
+    rereg.seen.resize(cluster.shardCount());
+    for (uint32_t s = 0; s < cluster.shardCount(); s++) rereg.seen[s].assign(cluster.shardSize(s), false);
+    rereg.expected = 0;
+    cluster.forEach([](const NodeView &node) {
+        if (node.status == NodeStatus::Failed || node.status == NodeStatus::Left) {
+            rereg.seen[NodeTable::shardOf(node.handle)][NodeTable::indexOf(node.handle)] = true;
+        } else {
+            rereg.expected++;
+        }
+    });
+    rereg.done = 0;
+    rereg.reported = rereg.expected == 0;
+}
+
+double reregistrationSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - rereg.start).count();
+}
+
+// Called for every admitted REGISTER
+void noteRegistration(uint32_t handle) {
+    if (handle == NodeTable::INVALID_HANDLE) return;
+    std::lock_guard<std::mutex> lock(rereg_mutex);
+    if (rereg.reported) return;
+    std::vector<bool> &seen = rereg.seen[NodeTable::shardOf(handle)];
+    uint32_t i = NodeTable::indexOf(handle);
+    if (i >= seen.size() || seen[i]) return;
+    seen[i] = true;
+    if (++rereg.done < rereg.expected) return;
+    rereg.reported = true;
+    char secs[32];
+    snprintf(secs, sizeof(secs), "%.2f", reregistrationSeconds());
+    logger.info("Cluster re-registered: " + std::to_string(rereg.done) + " nodes in " + secs + "s");
+}
+
+// Periodic progress line from the monitor while nodes are still missing,
+// and a final one once the timeout has passed
+void reportReregistration() {
+    std::lock_guard<std::mutex> lock(rereg_mutex);
+    if (rereg.reported) return;
+    double elapsed = reregistrationSeconds();
+    char secs[32];
+    snprintf(secs, sizeof(secs), "%.1f", elapsed);
+    std::string count = std::to_string(rereg.done) + "/" + std::to_string(rereg.expected);
+    if (elapsed * 1000 >= options.timeout_ms) {
+        rereg.reported = true;
+        logger.info("Re-registration window closed: " + count + " nodes came back within " + secs + "s");
+        return;
+    }
+    logger.info("Re-registered " + count + " nodes after " + secs + "s");
+}
+
+// ----------------------------------------------------
+// Folds the shared-memory board into the cluster. A slot whose timestamp
+// moved since the last scan counts as one heartbeat; that timestamp is
+// CLOCK_MONOTONIC, so it becomes last_seen as it is. Nodes are added the
+// first time their slot is seen beating.
+// ----------------------------------------------------
+void scanBoard() {
+    uint64_t beats = 0;
+
+    board->forEachClaimed([&](uint32_t i, std::string_view id, uint64_t, uint64_t beat_ns) {
+        if (i >= board_last_beat.size()) {
+            board_last_beat.resize(i + 1, 0);
+            board_handles.resize(i + 1, uint32_t(NodeTable::INVALID_HANDLE));
+        }
+        if (beat_ns == 0 || beat_ns == board_last_beat[i]) return;
+        board_last_beat[i] = beat_ns;
+
+        int64_t seen = (int64_t)beat_ns;
+        if (!cluster.touch(board_handles[i], seen)) {
+            board_handles[i] = cluster.upsert(id, seen, NodeStatus::Active);
+            logger.info("Node " + std::string(id) + " joined through shared memory");
+        }
+        beats++;
+    });
+    heartbeats_received.add(beats);
+}
+
+// ----------------------------------------------------
+// Subscribers to node transitions. Alerts are logged as they happen;
+// display and persistence only note that there is something new and
+// leave the work to the monitor thread.
+// ----------------------------------------------------
+void alertTransition(const NodeEvent &event) {
+    if (event.added) return; // REGISTER and the board log their own joins
+    std::string node = "Node " + std::string(event.id);
+    switch (event.to) {
+        case NodeStatus::Suspect:
+            logger.warn(node + " suspect (missed heartbeats)");
+            break;
+        case NodeStatus::Failed:
+            logger.warn(node + " failed (no heartbeat)");
+            break;
+        case NodeStatus::Left:
+            logger.info(node + " left the cluster");
+            break;
+        case NodeStatus::Active:
+            if (event.from == NodeStatus::Suspect || event.from == NodeStatus::Failed) {
+                logger.info(node + " recovered (was " + statusName(event.from) + ")");
+            }
+            break;
+        default:
+            break;
     }
-    std::cout << "=====================\n" << std::endl;
+}
+
+void subscribeToTransitions() {
+    cluster.subscribe(alertTransition);
+    cluster.subscribe([](const NodeEvent &) { display_pending.store(true, std::memory_order_relaxed); });
 }
 
 // ----------------------------------------------------
-// Thread that monitors nodes and marks failures
+// Thread that monitors nodes and marks failures. It sleeps until the
+// failure detector's next deadline or the next housekeeping pass,
+// whichever comes first.
 // ----------------------------------------------------
 void monitorNodes() {
     logger.info("Monitor thread started...");
-    displayClusterState(); // show on startup
+    snapshots.publish(LivenessClock::tick());
+    requestReport(true, false, detector->stats()); // show on startup
+    const int64_t ms = 1000000;
+    // New deadlines are only filed when the monitor wakes, so it never
+    // sleeps longer than the suspect timeout
+    const int64_t max_sleep = std::min(HOUSEKEEPING_MS, options.suspect_ms) * ms;
+    // Board beats only count once scanned, so scan at least twice per
+    // suspect timeout or short --timeout-ms values fail healthy nodes
+    const int64_t board_period = std::max(1, std::min(HOUSEKEEPING_MS, options.suspect_ms / 2)) * ms;
+    int64_t next_housekeeping = LivenessClock::tick() + HOUSEKEEPING_MS * ms;
+    int64_t next_board_scan = board ? LivenessClock::now() + board_period : INT64_MAX;
 
     while (true) {
-        std::this_thread::sleep_for(std::chrono::seconds(2));
-        time_t now = time(nullptr);
-        bool failure_detected = false;
+        int64_t now = LivenessClock::tick();
+        bool housekeeping = now >= next_housekeeping;
+        if (now >= next_board_scan) {
+            scanBoard();
+            next_board_scan = now + board_period;
+        }
+        if (housekeeping && options.storm) reportReregistration();
+        detector->advance(now);
 
-        {
-            std::lock_guard<std::mutex> lock(cluster_mutex);
-            for (auto &[node, info] : cluster) {
-                double diff = difftime(now, info.last_seen);
-                if (diff > TIMEOUT && info.status == "active") {
-                    info.status = "failed";
-                    logger.warn("Node " + node + " failed (no heartbeat)");
-                    failure_detected = true;
-                }
+        if (housekeeping) {
+            next_housekeeping = now + HOUSEKEEPING_MS * ms;
+            // last_seen moves without events, so the display still runs
+            // every DISPLAY_INTERVAL. Persistence runs every pass: it only
+            // writes what changed, if anything.
+            time_t wall = time(nullptr);
+            bool display = display_pending.exchange(false) || difftime(wall, last_display_time) >= DISPLAY_INTERVAL;
+            if (display) {
+                last_display_time = wall;
+                snapshots.publish(now);
             }
+            requestReport(display, true, detector->stats());
         }
 
-        if (failure_detected || difftime(now, last_display_time) >= DISPLAY_INTERVAL) {
-            displayClusterState();
-            persistClusterState();
-            last_display_time = now;
+        int64_t wake = std::min({detector->nextDeadline(now), next_housekeeping, next_board_scan, now + max_sleep});
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::max<int64_t>(wake - LivenessClock::read(), ms)));
+    }
+}
+
+// ----------------------------------------------------
+// Applies a batch of queued heartbeats
+// ----------------------------------------------------
+void applyHeartbeats(const HeartbeatEvent *events, size_t count) {
+    int64_t now = LivenessClock::now();
+    for (size_t i = 0; i < count; i++) cluster.touch(events[i].handle, now);
+    heartbeats_received.add(count);
+}
+
+// ----------------------------------------------------
+// Marks a node alive by handle: a relaxed store into the record arrays,
+// no lock. Returns false for unknown or stale handles, which the sender
+// must re-register.
+// With an applier pool the handle is only checked here and the update is
+// queued; if the queue is full it is applied inline instead of dropped.
+// ----------------------------------------------------
+bool recordHeartbeat(uint32_t handle) {
+    if (applier_pool) {
+        if (!cluster.valid(handle)) return false;
+        if (applier_pool->submit({handle, LivenessClock::now()})) return true;
+    }
+    if (!cluster.touch(handle, LivenessClock::now())) return false;
+    heartbeats_received.add();
+    return true;
+}
+
+// ----------------------------------------------------
+// Legacy heartbeat that carries the node ID. Nodes heard from for the
+// first time are added only when create_missing is set; returns false if
+// the node is unknown.
+// ----------------------------------------------------
+bool recordHeartbeat(std::string_view node_id, bool create_missing) {
+    int64_t now = LivenessClock::now();
+    bool known = create_missing ? cluster.upsert(node_id, now, NodeStatus::Active) != NodeTable::INVALID_HANDLE
+                                : cluster.touch(cluster.find(node_id), now);
+    if (known) heartbeats_received.add();
+    return known;
+}
+
+void sendLine(Connection &conn, const std::string &line) {
+    conn.write(line);
+}
+
+// ----------------------------------------------------
+// Applies a relay's batch: the relay's own handle plus every handle in the
+// payload, in one pass. Stale handles are listed back so the relay can
+// tell those workers to re-register.
+// ----------------------------------------------------
+void applyHeartbeatBatch(Connection &conn, const Frame &frame, const char *payload) {
+    size_t count = frame.length / sizeof(uint32_t);
+    thread_local std::vector<uint32_t> handles, stale_handles;
+    handles.resize(count);
+    memcpy(handles.data(), payload, count * sizeof(uint32_t)); // payload is unaligned
+    stale_handles.clear();
+
+    int64_t now = LivenessClock::now();
+    bool relay_known = cluster.touch(frame.handle, now);
+    size_t applied = cluster.touchAll(handles.data(), count, now, &stale_handles);
+    heartbeats_received.add(applied + relay_known);
+
+    std::string stale = relay_known ? "" : "REREGISTER\n";
+    for (uint32_t handle : stale_handles) stale += "REREGISTER " + std::to_string(handle) + "\n";
+    if (!stale.empty()) sendLine(conn, stale);
+}
+
+// ----------------------------------------------------
+// Applies a single protocol line to the cluster state
+// ----------------------------------------------------
+void dispatchLine(Connection &conn, std::string_view line, size_t verb_len) {
+    Command cmd = splitCommand(line, verb_len);
+
+    if (cmd.verb == "HB" && !cmd.arg.empty()) {
+        if (!recordHeartbeat(parseHandle(cmd.arg))) sendLine(conn, "REREGISTER\n");
+    }
+    else if (cmd.verb == "REGISTER" && !cmd.arg.empty()) {
+        int64_t retry_ms;
+        if (!admitRegistration(retry_ms)) {
+            sendLine(conn, "RETRY " + std::to_string(retry_ms) + "\n");
+            return;
+        }
+        std::string node_id(cmd.arg);
+        if (!NodeId::fits(node_id)) {
+            logger.warn("REGISTER rejected: node ID longer than " + std::to_string(NodeId::CAPACITY) + " bytes");
+            sendLine(conn, "REJECTED node ID longer than " + std::to_string(NodeId::CAPACITY) + " bytes\n");
+            return;
+        }
+        uint32_t handle = cluster.join(node_id, LivenessClock::now());
+        if (handle == NodeTable::INVALID_HANDLE) {
+            logger.warn("REGISTER rejected: node table full");
+            sendLine(conn, "REJECTED node table full\n");
+            return;
+        }
+        noteRegistration(handle);
+        conn.registered = true;
+        if (!options.storm) logger.info("REGISTER received for " + node_id);
+        // Old workers never read replies; new ones use the handle from here on
+        sendLine(conn, "OK " + std::to_string(handle) + "\n");
+    }
+    else if (cmd.verb == "HEARTBEAT" && !cmd.arg.empty()) {
+        recordHeartbeat(cmd.arg, true);
+    }
+    else if (cmd.verb == "LEAVE" && !cmd.arg.empty()) {
+        cluster.leave(parseHandle(cmd.arg), LivenessClock::now());
+    }
+    else if (cmd.verb == "PROTO" && conn.registered) {
+        // Binary frame offer: accept our version if the worker supports it.
+        // The worker only switches after reading this reply. An offer that
+        // follows a REGISTER we told to RETRY is ignored.
+        int offered = atoi(std::string(cmd.arg).c_str());
+        if (offered >= PROTOCOL_VERSION) {
+            sendLine(conn, "PROTO " + std::to_string(PROTOCOL_VERSION) + "\n");
+            conn.binary = true;
+        }
+    }
+    else if (cmd.verb == "CHANGES") {
+        uint64_t since = 0;
+        std::from_chars(cmd.arg.data(), cmd.arg.data() + cmd.arg.size(), since);
+        std::vector<uint32_t> changed;
+        uint64_t next = cluster.changedSince(since, changed);
+        // Handles logged before a takeover changed the handle tag no
+        // longer read; leave them out rather than report garbage
+        std::vector<NodeView> nodes;
+        nodes.reserve(changed.size());
+        NodeView node;
+        for (uint32_t handle : changed) {
+            if (cluster.read(handle, node)) nodes.push_back(node);
         }
+        // Written in pieces, so a reply for the whole cluster is only held
+        // once, as whatever the socket has not taken yet
+        std::string reply = "CHANGES " + std::to_string(next) + " " + std::to_string(nodes.size()) + "\n";
+        for (const NodeView &n : nodes) {
+            reply += "NODE " + std::string(n.id) + " " + statusName(n.status) + " " +
+                     std::to_string(LivenessClock::toWall(n.since)) + "\n";
+            if (reply.size() >= CHANGES_CHUNK) {
+                sendLine(conn, reply);
+                reply.clear();
+            }
+        }
+        sendLine(conn, reply);
+    }
+    else if (cmd.verb == "STATS") {
+        std::string reply = "STATS heartbeats=" + std::to_string(heartbeats_received.total()) +
+                            " nodes=" + std::to_string(cluster.size());
+        if (applier_pool) {
+            ApplierStats s = applier_pool->stats();
+            reply += " queue_depth=" + std::to_string(s.queue_depth) +
+                     " batches=" + std::to_string(s.batches) +
+                     " overflows=" + std::to_string(s.overflows) +
+                     " apply_avg_us=" + std::to_string(s.avg_latency_us) +
+                     " apply_max_us=" + std::to_string(s.max_latency_us);
+        }
+        reply += " " + slabSummary("slab_");
+        sendLine(conn, reply + "\n");
+    }
+}
+
+// ----------------------------------------------------
+// Applies a single binary frame. The decoder has already checked magic,
+// version and length, so this is just a switch on the type.
+// ----------------------------------------------------
+void dispatchFrame(Connection &conn, const Frame &frame, const char *payload) {
+    switch (frame.type) {
+        case FRAME_HEARTBEAT:
+            if (!recordHeartbeat(frame.handle)) sendLine(conn, "REREGISTER\n");
+            break;
+        case FRAME_HEARTBEAT_BATCH:
+            applyHeartbeatBatch(conn, frame, payload);
+            break;
+        case FRAME_LEAVE:
+            cluster.leave(frame.handle, LivenessClock::now());
+            break;
+        default:
+            break; // unknown types are skipped; length already framed them
     }
 }
 
 // ----------------------------------------------------
-// Handles each client connection
+// The protocol for one connection, as a coroutine on the reactor thread:
+// text lines until binary frames are negotiated, then frames.
 // ----------------------------------------------------
-void handleClient(int client_sock) {
-    char buffer[1024];
+Task serveConnection(Connection &conn) {
+    while (!conn.binary) {
+        TextLine line = co_await conn.readLine();
+        dispatchLine(conn, line.text, line.verb_len);
+    }
     while (true) {
-        memset(buffer, 0, sizeof(buffer));
-        ssize_t bytes_read = read(client_sock, buffer, sizeof(buffer) - 1);
-        if (bytes_read <= 0) break;
-
-        std::string msg(buffer);
-        
-        // Process line by line to prevent concatenation
-        size_t pos = 0;
-        while ((pos = msg.find('\n')) != std::string::npos) {
-            std::string line = msg.substr(0, pos);
-            msg.erase(0, pos + 1);
-            
-            // Trim whitespace
-            line.erase(0, line.find_first_not_of(" \t\r"));
-            line.erase(line.find_last_not_of(" \t\r") + 1);
-            
-            if (line.rfind("REGISTER ", 0) == 0) {
-                std::string node_id = line.substr(9);
-                std::lock_guard<std::mutex> lock(cluster_mutex);
-                cluster[node_id] = {time(nullptr), "active"};
-                logger.info("REGISTER received for " + node_id);
-            }
-            else if (line.rfind("HEARTBEAT ", 0) == 0) {
-                std::string node_id = line.substr(10);
-                std::lock_guard<std::mutex> lock(cluster_mutex);
-                cluster[node_id].last_seen = time(nullptr);
-                cluster[node_id].status = "active";
+        FrameView f = co_await conn.readFrame();
+        dispatchFrame(conn, *f.frame, f.payload);
+    }
+}
+
+// ----------------------------------------------------
+// Per-connection data handler, driven by the reactor backend.
+// The framer (or frame decoder, once binary is negotiated) decodes
+// straight out of the receive buffer, carries a split message over to
+// the next chunk, and resumes the connection's coroutine once per
+// complete message.
+// ----------------------------------------------------
+bool handleClient(Connection &conn, const char *data, size_t len) {
+    if (!conn.handler) conn.handler = serveConnection(conn);
+    bool ok;
+    if (conn.binary) {
+        ok = conn.decoder.feed(data, len, [&conn](const Frame &frame, const char *payload) {
+            conn.deliver(FrameView{&frame, payload});
+        });
+    } else {
+        ok = conn.framer.feed(data, len, [&conn](std::string_view line, size_t verb_len) {
+            conn.deliver(TextLine{line, verb_len});
+        });
+    }
+    return ok && !conn.handler.done();
+}
+
+// ----------------------------------------------------
+// UDP datagram handler. Only heartbeats and LEAVE are accepted here;
+// REGISTER and control traffic stay on TCP. Unknown nodes and stale handles are told
+// to re-register.
+// ----------------------------------------------------
+std::string handleDatagram(std::string_view payload) {
+    std::string reply;
+    while (!payload.empty()) {
+        size_t nl = payload.find('\n');
+        std::string_view line = payload.substr(0, nl);
+        payload.remove_prefix(nl == std::string_view::npos ? payload.size() : nl + 1);
+        Command cmd = splitCommand(line, std::min(line.find(' '), line.size()));
+
+        if (cmd.verb == "HB" && !cmd.arg.empty()) {
+            if (!recordHeartbeat(parseHandle(cmd.arg))) reply += "REREGISTER\n";
+        }
+        else if (cmd.verb == "LEAVE" && !cmd.arg.empty()) {
+            cluster.leave(parseHandle(cmd.arg), LivenessClock::now());
+        }
+        else if (cmd.verb == "HEARTBEAT" && !cmd.arg.empty()) {
+            std::string_view node_id = cmd.arg;
+            if (!recordHeartbeat(node_id, false)) {
+                reply += "REREGISTER ";
+                reply += node_id;
+                reply += "\n";
             }
         }
     }
-    close(client_sock);
+    return reply;
 }
 
 // ----------------------------------------------------
-// Server start function
+// Opens one listening socket on PORT. SO_REUSEPORT lets every reactor bind
+// its own socket and have the kernel spread new connections across them.
 // ----------------------------------------------------
-void startServer() {
-    server_sock_global = socket(AF_INET, SOCK_STREAM, 0);
+int openListenSocket() {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
     
     // Allow port reuse immediately after restart
     int opt = 1;
-    setsockopt(server_sock_global, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt));
     
     sockaddr_in server_addr{};
     server_addr.sin_family = AF_INET;
     server_addr.sin_addr.s_addr = INADDR_ANY;
     server_addr.sin_port = htons(PORT);
 
-    bind(server_sock_global, (struct sockaddr*)&server_addr, sizeof(server_addr));
-    listen(server_sock_global, 5);
-    logger.info("Manager listening on port " + std::to_string(PORT));
+    if (bind(sock, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(sock, options.backlog) < 0) {
+        logger.warn(std::string("Cannot listen on port ") + std::to_string(PORT) + ": " + strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// ----------------------------------------------------
+// Opens the AF_UNIX listener. Same-host workers speak the same protocol
+// over it without going through the loopback TCP stack. A socket file
+// left behind by a previous run is removed first.
+// ----------------------------------------------------
+int openUnixSocket(const std::string &path) {
+    sockaddr_un addr{};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        logger.warn("Unix socket path too long: " + path);
+        return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    unlink(path.c_str());
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 ||
+        listen(sock, options.backlog) < 0) {
+        logger.warn("Cannot listen on " + path + ": " + strerror(errno));
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// ----------------------------------------------------
+// Failure detection, the heartbeat board and reporting outlive a server
+// run: a backup whose server stops and later takes over again keeps them,
+// so listeners and threads are never duplicated.
+// ----------------------------------------------------
+void startMonitoring() {
+    subscribeToTransitions();
+    detector.reset(new FailureDetector(cluster, options.suspect_ms * int64_t(1000000),
+                                       options.timeout_ms * int64_t(1000000), LivenessClock::tick()));
+    if (!options.shm_name.empty()) {
+        board.reset(new HeartbeatBoard(options.shm_name, HeartbeatBoard::DEFAULT_SLOTS));
+        if (board->ok()) {
+            logger.info("Scanning shared-memory heartbeat board " + options.shm_name);
+        } else {
+            logger.warn("Cannot create heartbeat board " + options.shm_name + ": " + strerror(errno));
+            board.reset();
+        }
+    }
 
     std::thread monitorThread(monitorNodes);
     monitorThread.detach();
+    std::thread reportThread(reportNodes);
+    reportThread.detach();
+}
+
+// ----------------------------------------------------
+// Server start function
+// ----------------------------------------------------
+void startServer() {
+    raiseFdLimit();
 
-    while (!shutdown_requested) {
-        sockaddr_in client_addr{};
-        socklen_t client_len = sizeof(client_addr);
-        int client_sock = accept(server_sock_global, (struct sockaddr*)&client_addr, &client_len);
-        
-        if (client_sock < 0) {
-            if (shutdown_requested) break;
-            continue;
+    std::vector<int> listen_socks;
+    for (int i = 0; i < options.reactors; i++) {
+        int sock = openListenSocket();
+        if (sock < 0) break;
+        listen_socks.push_back(sock);
+    }
+    if (listen_socks.empty()) return;
+    server_sock_global = listen_socks.front();
+    startReregistration();
+    static std::once_flag monitoring;
+    std::call_once(monitoring, startMonitoring);
+    Backend backend = resolveBackend(options.backend);
+    logger.info("Manager listening on port " + std::to_string(PORT) + " with " +
+                std::to_string(listen_socks.size()) + " " + backendName(backend) + " reactor(s)");
+    if (options.admit_rate > 0) {
+        logger.info("Admitting at most " + std::to_string(options.admit_rate) +
+                    " REGISTERs/s, listen backlog " + std::to_string(options.backlog));
+    }
+
+    if (options.appliers > 0) {
+        applier_pool.reset(new ApplierPool(options.appliers, HEARTBEAT_QUEUE_CAPACITY, applyHeartbeats));
+        logger.info("Applying heartbeats on " + std::to_string(options.appliers) + " applier thread(s)");
+    }
+
+    // The unix socket gets a reactor of its own next to the TCP ones
+    int unix_sock = -1;
+    if (!options.unix_path.empty()) {
+        unix_sock = openUnixSocket(options.unix_path);
+        if (unix_sock >= 0) {
+            logger.info("Manager listening on unix socket " + options.unix_path);
+            listen_socks.push_back(unix_sock);
+        }
+    }
+
+    std::unique_ptr<UdpListener> udp;
+    std::thread udpThread;
+    if (options.udp) {
+        udp.reset(new UdpListener(PORT, handleDatagram));
+        if (udp->ok()) {
+            logger.info("Accepting UDP heartbeats on port " + std::to_string(PORT));
+            udpThread = std::thread([&udp] { udp->run(shutdown_requested); });
         }
-        
-        std::thread(handleClient, client_sock).detach();
     }
+
+    // Each reactor thread owns its own listening socket and epoll set
+    std::vector<std::thread> reactors;
+    for (int sock : listen_socks) {
+        reactors.emplace_back([sock, backend] {
+            std::unique_ptr<Reactor> reactor = makeReactor(backend, sock, handleClient);
+            reactor->run(shutdown_requested);
+        });
+    }
+    for (auto &t : reactors) t.join();
+    if (udpThread.joinable()) udpThread.join();
+    applier_pool.reset(); // applies whatever is still queued, then joins
     
-    close(server_sock_global);
+    for (int sock : listen_socks) close(sock);
+    if (unix_sock >= 0) unlink(options.unix_path.c_str());
     logger.info("Manager shut down gracefully.");
 }
 
@@ -216,7 +973,55 @@ bool isPortAvailable(int port) {
 // ----------------------------------------------------
 int main(int argc, char* argv[]) {
     std::string role = "primary";
-    if (argc >= 2) role = argv[1];
+    bool backlog_set = false, admit_rate_set = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--reactors" && i + 1 < argc) {
+            options.reactors = std::max(1, atoi(argv[++i]));
+        } else if (arg == "--backend" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "epoll") options.backend = Backend::Epoll;
+            else if (name == "uring") options.backend = Backend::Uring;
+            else options.backend = Backend::Auto;
+        } else if (arg == "--udp") {
+            options.udp = true;
+        } else if (arg == "--appliers" && i + 1 < argc) {
+            options.appliers = std::max(0, atoi(argv[++i]));
+        } else if (arg == "--unix" && i + 1 < argc) {
+            options.unix_path = argv[++i];
+        } else if (arg == "--shm" && i + 1 < argc) {
+            options.shm_name = argv[++i];
+        } else if (arg == "--hugepages") {
+            SlabPool::setHugePages(true);
+        } else if (arg == "--storm") {
+            options.storm = true;
+        } else if (arg == "--backlog" && i + 1 < argc) {
+            options.backlog = std::max(1, atoi(argv[++i]));
+            backlog_set = true;
+        } else if (arg == "--timeout-ms" && i + 1 < argc) {
+            options.timeout_ms = std::max(1, atoi(argv[++i]));
+            options.suspect_ms = std::max(1, (int)(options.timeout_ms * 5LL / 11));
+        } else if (arg == "--max-nodes" && i + 1 < argc) {
+            options.max_nodes = std::max(0L, atol(argv[++i]));
+        } else if (arg == "--admit-rate" && i + 1 < argc) {
+            options.admit_rate = std::max(0, atoi(argv[++i]));
+            admit_rate_set = true;
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << USAGE << std::endl;
+            return 1;
+        } else {
+            role = arg;
+        }
+    }
+    // Storm mode defaults, unless given explicitly
+    if (options.storm && !backlog_set) options.backlog = STORM_BACKLOG;
+    if (options.storm && !admit_rate_set) options.admit_rate = STORM_ADMIT_RATE;
+    // Before anything is loaded, so the table never grows (or rehashes)
+    // on the way to the expected size
+    if (options.max_nodes > 0) {
+        cluster.reserve(options.max_nodes);
+        logger.info("Preallocated the node table for " + std::to_string(options.max_nodes) + " nodes");
+    }
 
     if (role == "primary") {
         std::cout << "[INFO] Starting PRIMARY manager..." << std::endl;
@@ -238,7 +1043,7 @@ int main(int argc, char* argv[]) {
         }
     }
     else {
-        std::cerr << "Usage: ./manager [primary|backup]" << std::endl;
+        std::cerr << USAGE << std::endl;
     }
 
     return 0;
@@ -0,0 +1,399 @@
+// node_table.cpp
+#include "node_table.hpp"
+#include <functional>
+#include <random>
+#include <thread>
+
+const uint32_t INITIAL_INDEX_SLOTS = 64;
+
+const char *statusName(NodeStatus status) {
+    switch (status) {
+        case NodeStatus::Joining: return "joining";
+        case NodeStatus::Active: return "active";
+        case NodeStatus::Suspect: return "suspect";
+        case NodeStatus::Left: return "left";
+        default: return "failed";
+    }
+}
+
+NodeStatus parseStatus(std::string_view name) {
+    if (name == "joining") return NodeStatus::Joining;
+    if (name == "active") return NodeStatus::Active;
+    if (name == "suspect") return NodeStatus::Suspect;
+    if (name == "left") return NodeStatus::Left;
+    return NodeStatus::Failed;
+}
+
+NodeTable::Shard::Shard() : block_slab(sizeof(Block)), slots(INITIAL_INDEX_SLOTS, IndexSlot{0, EMPTY_SLOT}) {}
+
+NodeTable::Shard::~Shard() {
+    for (auto &block : blocks) block_slab.destroy(block.load());
+}
+
+// Returns the record index for id, or EMPTY_SLOT
+uint32_t NodeTable::Shard::lookup(const NodeId &id, uint32_t hash) {
+    uint32_t mask = (uint32_t)slots.size() - 1;
+    for (uint32_t pos = hash & mask, dist = 0;; pos = (pos + 1) & mask, dist++) {
+        const IndexSlot &slot = slots[pos];
+        if (slot.index == EMPTY_SLOT || ((pos - slot.hash) & mask) < dist) return EMPTY_SLOT;
+        if (slot.hash == hash && this->id(slot.index) == id) return slot.index;
+    }
+}
+
+void NodeTable::Shard::insert(uint32_t hash, uint32_t index) {
+    // Keep the load factor at or below 3/4
+    if ((count + 1) * 4 > slots.size() * 3) growIndex();
+    place(IndexSlot{hash, index});
+}
+
+void NodeTable::Shard::place(IndexSlot entry) {
+    uint32_t mask = (uint32_t)slots.size() - 1;
+    for (uint32_t pos = entry.hash & mask, dist = 0;; pos = (pos + 1) & mask, dist++) {
+        IndexSlot &slot = slots[pos];
+        if (slot.index == EMPTY_SLOT) {
+            slot = entry;
+            return;
+        }
+        // Take the slot from an entry that is closer to its home
+        uint32_t slot_dist = (pos - slot.hash) & mask;
+        if (slot_dist < dist) {
+            std::swap(slot, entry);
+            dist = slot_dist;
+        }
+    }
+}
+
+// Doubles the slot array. Hashes are stored, so IDs are not rehashed.
+void NodeTable::Shard::growIndex() {
+    resizeIndex(slots.size() * 2);
+}
+
+void NodeTable::Shard::resizeIndex(size_t slot_count) {
+    std::vector<IndexSlot> old(slot_count, IndexSlot{0, EMPTY_SLOT});
+    old.swap(slots);
+    for (const IndexSlot &entry : old) {
+        if (entry.index != EMPTY_SLOT) place(entry);
+    }
+}
+
+NodeTable::NodeTable(uint32_t shard_count) {
+    std::random_device rd;
+    tag = rd() % TAG_COUNT;
+    shard_count = std::clamp<uint32_t>(shard_count, 1, uint32_t(MAX_SHARDS));
+    for (uint32_t i = 0; i < shard_count; i++) shards.emplace_back(new Shard());
+}
+
+NodeTable::~NodeTable() = default;
+
+void NodeTable::reserve(size_t nodes) {
+    // Shards fill unevenly; leave some room above the average
+    size_t average = nodes / shards.size();
+    size_t per_shard = std::min(average + average / 16 + BLOCK_RECORDS, size_t(MAX_SHARD_NODES));
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        shard->block_slab.reserve((per_shard + BLOCK_RECORDS - 1) / BLOCK_RECORDS);
+        size_t slot_count = shard->slots.size();
+        while (per_shard * 4 > slot_count * 3) slot_count *= 2;
+        if (slot_count > shard->slots.size()) shard->resizeIndex(slot_count);
+    }
+}
+
+uint32_t NodeTable::hashId(std::string_view id) {
+    return (uint32_t)std::hash<std::string_view>()(id);
+}
+
+// The index uses the low bits of the same hash, so the shard is picked
+// from a remixed one
+uint32_t NodeTable::shardFor(uint32_t hash) const {
+    return (uint32_t)(((uint64_t)hash * 0x9E3779B9u) >> 32) % shards.size();
+}
+
+uint32_t NodeTable::upsert(std::string_view id, int64_t last_seen, NodeStatus status, int64_t since) {
+    if (!NodeId::fits(id)) return INVALID_HANDLE;
+    NodeId key(id);
+    uint32_t hash = hashId(id);
+    uint32_t s = shardFor(hash);
+    Shard &shard = *shards[s];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    uint32_t i = shard.lookup(key, hash);
+    bool added = i == EMPTY_SLOT;
+    if (added) {
+        if (shard.count >= MAX_SHARD_NODES) return INVALID_HANDLE;
+        i = shard.count;
+        if (i % BLOCK_RECORDS == 0) {
+            shard.blocks[i / BLOCK_RECORDS].store(shard.block_slab.create<Block>(), std::memory_order_release);
+        }
+        shard.blocks[i / BLOCK_RECORDS].load()->ids[i % BLOCK_RECORDS] = key;
+        shard.insert(hash, i);
+    }
+    Block &block = *shard.blocks[i / BLOCK_RECORDS].load();
+    uint32_t r = i % BLOCK_RECORDS;
+    uint32_t handle = makeHandle(s, i);
+    if (added) {
+        block.last_seen[r].store(pack(last_seen, SEEN_UNIT), std::memory_order_relaxed);
+        block.since[r].store(pack(since ? since : last_seen, SINCE_UNIT), std::memory_order_relaxed);
+        block.version[r].store((uint32_t)change_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        block.state[r].store(uint32_t(status), std::memory_order_relaxed);
+        // Publish only once the record is complete, and mark it afterwards
+        // so changedSince() never hands out an unpublished handle
+        shard.count++;
+        shard.published.store(shard.count, std::memory_order_release);
+        markChanged(block, r, handle);
+        notify(NodeEvent{handle, id, status, status, last_seen, true});
+    } else {
+        // A failed transition leaves the current status in `from`; once it
+        // is the wanted one, last_seen alone is left to store
+        NodeStatus from = statusOf(block.state[r].load(std::memory_order_relaxed));
+        while (from != status && !transition(block, r, handle, from, status, since ? since : last_seen, last_seen)) {}
+        if (from == status) block.last_seen[r].store(pack(last_seen, SEEN_UNIT), std::memory_order_relaxed);
+    }
+    return handle;
+}
+
+uint32_t NodeTable::join(std::string_view id, int64_t now) {
+    uint32_t handle = find(id);
+    if (handle == INVALID_HANDLE) return upsert(id, now, NodeStatus::Joining);
+
+    // Known node: a live one keeps its status, anything else starts over
+    Block &block = blockOf(handle);
+    uint32_t i = indexOf(handle) % BLOCK_RECORDS;
+    NodeStatus from = statusOf(block.state[i].load(std::memory_order_relaxed));
+    auto live = [&from] {
+        return from == NodeStatus::Active || from == NodeStatus::Suspect || from == NodeStatus::Joining;
+    };
+    while (!live() && !transition(block, i, handle, from, NodeStatus::Joining, now, now)) {}
+    if (live()) block.last_seen[i].store(pack(now, SEEN_UNIT), std::memory_order_relaxed);
+    return handle;
+}
+
+uint32_t NodeTable::find(std::string_view id) const {
+    if (!NodeId::fits(id)) return INVALID_HANDLE;
+    uint32_t hash = hashId(id);
+    uint32_t s = shardFor(hash);
+    Shard &shard = *shards[s];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    uint32_t i = shard.lookup(NodeId(id), hash);
+    return i == EMPTY_SLOT ? INVALID_HANDLE : makeHandle(s, i);
+}
+
+bool NodeTable::transition(Block &block, uint32_t i, uint32_t handle, NodeStatus &from, NodeStatus to, int64_t at,
+                           int64_t seen) {
+    // Take the record's seqlock, as long as the status is still `from`
+    uint32_t state = block.state[i].load(std::memory_order_relaxed);
+    while (true) {
+        if (state & WRITING) {
+            std::this_thread::yield(); // the other writer was preempted mid-write
+            state = block.state[i].load(std::memory_order_relaxed);
+        } else if (statusOf(state) != from) {
+            from = statusOf(state);
+            return false;
+        } else if (block.state[i].compare_exchange_weak(state, state + WRITING, std::memory_order_acquire)) {
+            break;
+        }
+    }
+    // Readers need the field stores ordered after the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    if (seen != KEEP_SEEN) block.last_seen[i].store(pack(seen, SEEN_UNIT), std::memory_order_relaxed);
+    block.since[i].store(pack(at, SINCE_UNIT), std::memory_order_relaxed);
+    block.version[i].store((uint32_t)change_epoch.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    // Ends the write and sets the new status in one store
+    block.state[i].store(((state + 2 * WRITING) & ~STATUS_MASK) | uint32_t(to), std::memory_order_release);
+    markChanged(block, i, handle);
+    // Outside the write, so readers do not spin on slow listeners
+    notify(NodeEvent{handle, block.ids[i].view(), from, to, at, false});
+    return true;
+}
+
+// touch() for a node that is not active; kept out of line so the common
+// case stays a single store
+void NodeTable::revive(Block &block, uint32_t i, uint32_t handle, NodeStatus from, int64_t now) {
+    while (from != NodeStatus::Active && from != NodeStatus::Left &&
+           !transition(block, i, handle, from, NodeStatus::Active, now, now)) {}
+    if (from == NodeStatus::Active) block.last_seen[i].store(pack(now, SEEN_UNIT), std::memory_order_relaxed);
+}
+
+// Record bit first, block bit second: a harvest that clears the block bit
+// in between finds the record bit on its next pass
+void NodeTable::markChanged(Block &block, uint32_t i, uint32_t handle) {
+    block.dirty[i / 64].fetch_or(uint64_t(1) << (i % 64), std::memory_order_release);
+    uint32_t b = blockOfHandle(handle);
+    shards[shardOf(handle)]->dirty_blocks[b / 64].fetch_or(uint64_t(1) << (b % 64), std::memory_order_release);
+}
+
+// Appends and clears every dirty bit; called with changes_mutex held
+void NodeTable::harvestChanges(std::vector<uint32_t> &changed) {
+    for (uint32_t s = 0; s < shards.size(); s++) {
+        Shard &shard = *shards[s];
+        for (uint32_t w = 0; w < MAX_BLOCKS / 64; w++) {
+            if (!shard.dirty_blocks[w].load(std::memory_order_relaxed)) continue;
+            for (uint64_t blocks = shard.dirty_blocks[w].exchange(0, std::memory_order_acquire); blocks;
+                 blocks &= blocks - 1) {
+                uint32_t b = w * 64 + __builtin_ctzll(blocks);
+                Block &block = *shard.blocks[b].load(std::memory_order_acquire);
+                for (uint32_t k = 0; k < BLOCK_RECORDS / 64; k++) {
+                    if (!block.dirty[k].load(std::memory_order_relaxed)) continue;
+                    for (uint64_t bits = block.dirty[k].exchange(0, std::memory_order_acquire); bits;
+                         bits &= bits - 1) {
+                        changed.push_back(makeHandle(s, b * BLOCK_RECORDS + k * 64 + __builtin_ctzll(bits)));
+                    }
+                }
+            }
+        }
+    }
+}
+
+uint64_t NodeTable::changedSince(uint64_t epoch, std::vector<uint32_t> &changed) {
+    std::lock_guard<std::mutex> lock(changes_mutex);
+    // Changes stamped from here on belong to the next epoch
+    uint64_t closing = change_epoch.fetch_add(1, std::memory_order_relaxed);
+    EpochChanges harvested{closing, {}};
+    harvestChanges(harvested.handles);
+    if (!harvested.handles.empty()) {
+        logged += harvested.handles.size();
+        change_log.push_back(std::move(harvested));
+    }
+    // Once the log outgrows the table, replaying it costs more than
+    // listing every node
+    while (change_log.size() > 1 && logged > size()) {
+        logged -= change_log.front().handles.size();
+        log_start = change_log.front().epoch + 1;
+        change_log.pop_front();
+    }
+
+    size_t first = changed.size();
+    if (epoch < log_start) {
+        for (uint32_t s = 0; s < shards.size(); s++) {
+            uint32_t count = shards[s]->published.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < count; i++) changed.push_back(makeHandle(s, i));
+        }
+        return closing + 1;
+    }
+    for (auto entry = change_log.rbegin(); entry != change_log.rend() && entry->epoch >= epoch; ++entry) {
+        changed.insert(changed.end(), entry->handles.begin(), entry->handles.end());
+    }
+    // A node changed in several epochs is listed in each
+    std::sort(changed.begin() + first, changed.end());
+    changed.erase(std::unique(changed.begin() + first, changed.end()), changed.end());
+    return closing + 1;
+}
+
+uint64_t NodeTable::subscribe(NodeListener listener) {
+    listeners.emplace_back(++next_listener, std::move(listener));
+    return next_listener;
+}
+
+void NodeTable::unsubscribe(uint64_t token) {
+    listeners.erase(std::remove_if(listeners.begin(), listeners.end(),
+                                   [token](const auto &entry) { return entry.first == token; }),
+                    listeners.end());
+}
+
+void NodeTable::notify(const NodeEvent &event) const {
+    for (const auto &entry : listeners) entry.second(event);
+}
+
+bool NodeTable::leave(uint32_t handle, int64_t now) {
+    if (!valid(handle)) return false;
+    Block &block = blockOf(handle);
+    uint32_t i = indexOf(handle) % BLOCK_RECORDS;
+    NodeStatus from = statusOf(block.state[i].load(std::memory_order_relaxed));
+    while (from != NodeStatus::Left && !transition(block, i, handle, from, NodeStatus::Left, now)) {}
+    return true;
+}
+
+size_t NodeTable::sweep(int64_t suspect_cutoff, int64_t fail_cutoff, int64_t now) {
+    size_t changed = 0;
+    OldestSeen oldest;
+    for (uint32_t s = 0; s < shards.size(); s++) {
+        for (uint32_t b = 0; b < blockCount(s); b++) {
+            changed += expireBlock(s, b, suspect_cutoff, fail_cutoff, now, oldest);
+        }
+    }
+    return changed;
+}
+
+size_t NodeTable::expireBlock(uint32_t s, uint32_t b, int64_t suspect_cutoff, int64_t fail_cutoff,
+                              int64_t now, OldestSeen &oldest) {
+    oldest = OldestSeen();
+    const Shard &shard = *shards[s];
+    uint32_t count = shard.published.load(std::memory_order_acquire);
+    if (b * BLOCK_RECORDS >= count) return 0;
+    Block &block = *shard.blocks[b].load(std::memory_order_acquire);
+    uint32_t n = std::min(count - b * BLOCK_RECORDS, uint32_t(BLOCK_RECORDS));
+
+    size_t changed = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int64_t seen = unpack(block.last_seen[i].load(std::memory_order_relaxed), SEEN_UNIT, now);
+        if (seen <= suspect_cutoff) {
+            changed += expireRecord(block, i, makeHandle(s, b * BLOCK_RECORDS + i), suspect_cutoff, fail_cutoff, now);
+        }
+        switch (statusOf(block.state[i].load(std::memory_order_relaxed))) {
+            case NodeStatus::Active: oldest.active = std::min(oldest.active, seen); break;
+            case NodeStatus::Joining:
+            case NodeStatus::Suspect: oldest.waiting = std::min(oldest.waiting, seen); break;
+            default: break;
+        }
+    }
+    return changed;
+}
+
+size_t NodeTable::expireRecord(Block &block, uint32_t i, uint32_t handle, int64_t suspect_cutoff,
+                               int64_t fail_cutoff, int64_t now) {
+    int64_t seen = unpack(block.last_seen[i].load(std::memory_order_relaxed), SEEN_UNIT, now);
+    if (seen > suspect_cutoff) return 0;
+    size_t changed = 0;
+    NodeStatus from = statusOf(block.state[i].load(std::memory_order_relaxed));
+    // A node overdue by the full timeout goes through suspect to failed in
+    // one call, so subscribers still see both
+    if (from == NodeStatus::Active && transition(block, i, handle, from, NodeStatus::Suspect, now)) {
+        changed++;
+        from = NodeStatus::Suspect;
+    }
+    if (seen <= fail_cutoff && (from == NodeStatus::Suspect || from == NodeStatus::Joining) &&
+        transition(block, i, handle, from, NodeStatus::Failed, now)) {
+        changed++;
+    }
+    return changed;
+}
+
+size_t NodeTable::touchAll(const uint32_t *handles, size_t count, int64_t now,
+                           std::vector<uint32_t> *stale) {
+    size_t applied = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (touch(handles[i], now)) applied++;
+        else if (stale) stale->push_back(handles[i]);
+    }
+    return applied;
+}
+
+size_t NodeTable::size() const {
+    size_t total = 0;
+    for (auto &shard : shards) total += shard->published.load(std::memory_order_acquire);
+    return total;
+}
+
+SlabStats NodeTable::recordStats() const {
+    SlabStats sum;
+    sum.object_size = sizeof(Block) / BLOCK_RECORDS;
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        SlabStats s = shard->block_slab.stats();
+        sum.in_use += shard->count;
+        sum.capacity += s.capacity * BLOCK_RECORDS;
+        sum.chunks += s.chunks;
+        sum.huge_chunks += s.huge_chunks;
+    }
+    return sum;
+}
+
+SlabStats NodeTable::indexStats() const {
+    SlabStats sum;
+    sum.object_size = sizeof(IndexSlot);
+    for (auto &shard : shards) {
+        std::lock_guard<std::mutex> lock(shard->mutex);
+        sum.in_use += shard->count;
+        sum.capacity += shard->slots.size();
+    }
+    return sum;
+}
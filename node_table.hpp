@@ -0,0 +1,420 @@
+#ifndef NODE_TABLE_HPP
+#define NODE_TABLE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "clock.hpp"
+#include "slab.hpp"
+
+// Node ID stored inline and zero-padded, so records and index probes never
+// touch the heap and two IDs compare with one fixed-size memcmp. Long
+// enough for every ID the shared-memory heartbeat board accepts.
+struct NodeId {
+    static const size_t CAPACITY = 40;
+    char bytes[CAPACITY] = {};
+
+    NodeId() = default;
+    explicit NodeId(std::string_view id) { memcpy(bytes, id.data(), std::min(id.size(), size_t(CAPACITY))); }
+
+    static bool fits(std::string_view id) {
+        return id.size() <= CAPACITY && id.find('\0') == std::string_view::npos;
+    }
+    std::string_view view() const { return {bytes, strnlen(bytes, CAPACITY)}; }
+    std::string str() const { return std::string(view()); }
+    bool operator==(const NodeId &other) const { return memcmp(bytes, other.bytes, CAPACITY) == 0; }
+};
+
+// ----------------------------------------------------
+// Node lifecycle
+//
+//   joining --heartbeat--> active --missed beats--> suspect --timeout--> failed
+//      |                     ^                         |                   |
+//      |                     +-------heartbeat---------+-------------------+
+//      +--------------------------timeout-------------------------------->+
+//
+// REGISTER puts a new, failed or departed node in joining (a node that is
+// still alive just stays active); its first heartbeat makes it active.
+// LEAVE moves any node to left, where heartbeats no longer revive it; it
+// has to REGISTER again.
+// ----------------------------------------------------
+enum class NodeStatus : uint8_t {
+    Joining,
+    Active,
+    Suspect,
+    Failed,
+    Left,
+};
+
+const char *statusName(NodeStatus status);
+NodeStatus parseStatus(std::string_view name); // unknown names are Failed
+
+// One node as seen by a walk. The ID never changes once published;
+// last_seen, status and since are a consistent copy that heartbeats may
+// already have overtaken. Times in the table are LivenessClock nanoseconds.
+struct NodeView {
+    uint32_t handle;
+    std::string_view id;
+    int64_t last_seen;
+    NodeStatus status;
+    int64_t since;    // when the node entered this status
+    uint64_t version; // change epoch of its last change
+};
+
+// Earliest last_seen among the nodes of a block that can still time out:
+// active ones (next: suspect) and joining or suspect ones (next: failed).
+// NO_NODE where there are none.
+struct OldestSeen {
+    static const int64_t NO_NODE = INT64_MAX;
+    int64_t active = NO_NODE;
+    int64_t waiting = NO_NODE;
+};
+
+// A status transition, or a node added to the table (added is set and
+// from == to)
+struct NodeEvent {
+    uint32_t handle;
+    std::string_view id;
+    NodeStatus from;
+    NodeStatus to;
+    int64_t at;
+    bool added;
+};
+using NodeListener = std::function<void(const NodeEvent &)>;
+
+// Table of every node the manager knows about, split into shards.
+//
+// A node ID hashes to one shard, and each shard has its own lock, records
+// and ID index. REGISTERs and heartbeats for different nodes rarely wait
+// on each other, and the monitor, display and persister walk the table
+// one shard at a time instead of stopping the whole cluster.
+//
+// REGISTER assigns each node a 32-bit handle: an 8-bit tag for this
+// manager instance, then the shard (SHARD_BITS) and the record's index
+// within it (INDEX_BITS). Heartbeats that carry the handle therefore go
+// straight to the right shard and record regardless of ID length or
+// cluster size. An instance that takes over the cluster state (a restart
+// or a failover) takes the tag after the previous instance's, so a handle
+// issued before is rejected as stale instead of silently hitting the
+// wrong node, whose slot the reload may have moved.
+//
+// Records are split into parallel arrays kept in blocks of BLOCK_RECORDS
+// that never move once created: 56 bytes a record, of which 40 are the
+// inline ID. The rest are 32-bit words: last_seen in milliseconds, since
+// in seconds, a state word packing the status with the seqlock sequence,
+// and the version. Times are stored modulo 2^32 units and widened back to
+// the value nearest a reference: now for a live node, since for one that
+// is not (it was last seen at most a timeout before that). This is exact
+// while a live node was seen within the last 24 days, which the failure
+// detector guarantees, and since is within 68 years.
+//
+// A heartbeat for an active node is a relaxed store to last_seen: no
+// lock. Every write of more than one field (a status change with its
+// since, and the last_seen that caused it) runs under the record's
+// seqlock: the writer makes its sequence odd, stores, and makes it even
+// again together with the new status. The writer only takes the seqlock
+// while the status is still what it saw, so each transition happens once
+// and is reported once to every subscriber. Two writers of the same
+// record wait for each other only for those few stores; readers never
+// block a writer and retry if a write overlapped their read, so read()
+// and walks always see a (last_seen, status, since) the record really
+// had. Heartbeats for active nodes leave the sequence alone, so they
+// never make a reader retry. The ID index is an open-addressing Robin
+// Hood table of (hash, index) pairs; it is only consulted at REGISTER
+// time and for legacy ID-carrying heartbeats.
+//
+// Changes are tracked for consumers that only want to do work for what
+// changed (persistence, watchers). A change is a node being added or
+// changing status; heartbeats only move last_seen and are not one, or
+// every node would be dirty every interval. Each change stamps the
+// record's version with the current change epoch and sets its bit in a
+// dirty bitmap (per block, with a per-shard bitmap of dirty blocks).
+// changedSince() closes the epoch, harvests the bitmap into a log of
+// changed handles per epoch and answers from the log, so a consumer pays
+// for the changes since it last asked, not for the cluster size.
+//
+// Thread-safe. upsert(), join() and find() take the lock of the ID's
+// shard, since they use its index, and changedSince() a lock of its own;
+// nothing else locks. A heartbeat racing
+// the sweep can leave a node that just came back suspect or failed until
+// its next heartbeat.
+class NodeTable {
+public:
+    static const uint32_t INVALID_HANDLE = 0xFFFFFFFF;
+    static const uint32_t SHARD_BITS = 4;
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t MAX_SHARDS = 1u << SHARD_BITS;
+    static const uint32_t MAX_SHARD_NODES = 1u << INDEX_BITS;
+    static const uint32_t BLOCK_RECORDS = 1024;
+    static const uint32_t MAX_BLOCKS = MAX_SHARD_NODES / BLOCK_RECORDS;
+    // Tags cycle through 0..0xFE: with tag 0xFF the last record of the
+    // last shard would get INVALID_HANDLE
+    static const uint32_t TAG_COUNT = 0xFF;
+
+    explicit NodeTable(uint32_t shard_count = MAX_SHARDS);
+    ~NodeTable();
+
+    NodeTable(const NodeTable &) = delete;
+    NodeTable &operator=(const NodeTable &) = delete;
+
+    // Registers a listener for every transition and returns the token
+    // that unsubscribes it. Listeners run on the thread that caused the
+    // transition (reactor, applier or monitor), possibly under a shard
+    // lock: they must be quick and must not call upsert(), join() or
+    // find(). Subscribe and unsubscribe only while no other thread uses
+    // the table.
+    uint64_t subscribe(NodeListener listener);
+    void unsubscribe(uint64_t token);
+
+    // Adds the node, or refreshes it if already known, with the given
+    // status. since defaults to last_seen. Returns its handle, or
+    // INVALID_HANDLE if its shard is full or the ID does not fit a NodeId.
+    uint32_t upsert(std::string_view id, int64_t last_seen, NodeStatus status, int64_t since = 0);
+
+    // REGISTER: like upsert(), but the node is joining unless it is still
+    // alive (active or suspect), in which case it is simply refreshed
+    uint32_t join(std::string_view id, int64_t now);
+
+    uint32_t find(std::string_view id) const;
+
+    // Heartbeat as of `now`: refreshes last_seen and makes a joining,
+    // suspect or failed node active. A node that left ignores it until it
+    // registers again. Returns false for unknown or stale handles.
+    bool touch(uint32_t handle, int64_t now) {
+        if (!valid(handle)) return false;
+        Block &block = blockOf(handle);
+        uint32_t i = indexOf(handle) % BLOCK_RECORDS;
+        NodeStatus status = statusOf(block.state[i].load(std::memory_order_relaxed));
+        if (status == NodeStatus::Active) {
+            block.last_seen[i].store(pack(now, SEEN_UNIT), std::memory_order_relaxed);
+        } else if (status != NodeStatus::Left) {
+            revive(block, i, handle, status, now);
+        }
+        return true;
+    }
+
+    // LEAVE: the node shut down on purpose. Returns false for unknown or
+    // stale handles.
+    bool leave(uint32_t handle, int64_t now);
+
+    // ID of a record this table handed out. Records never move, so the
+    // view stays valid as long as the table.
+    std::string_view idOf(uint32_t handle) const {
+        return blockOf(handle).ids[indexOf(handle) % BLOCK_RECORDS].view();
+    }
+
+    // Consistent copy of one record. Returns false for unknown or stale
+    // handles.
+    bool read(uint32_t handle, NodeView &view) const {
+        if (!valid(handle)) return false;
+        view = readRecord(blockOf(handle), indexOf(handle) % BLOCK_RECORDS, handle);
+        return true;
+    }
+
+    // Closes the current change epoch and appends the handle of every
+    // node changed since `epoch` to `changed`, once each. Returns the
+    // epoch to pass next time. Pass 0 the first time; an epoch older than
+    // the log keeps (it holds about as many changes as there are nodes)
+    // gets every node. A change racing the call is reported by this call
+    // or the next.
+    uint64_t changedSince(uint64_t epoch, std::vector<uint32_t> &changed);
+
+    // touch() for a whole batch. Stale handles are appended to `stale` if
+    // given. Returns how many were applied.
+    size_t touchAll(const uint32_t *handles, size_t count, int64_t now,
+                    std::vector<uint32_t> *stale = nullptr);
+
+    // Whether touch() would find the handle. Records are never removed, so
+    // a handle that is valid now stays valid.
+    bool valid(uint32_t handle) const {
+        uint32_t s = shardOf(handle);
+        return (handle >> (SHARD_BITS + INDEX_BITS)) == tag && s < shards.size() &&
+               indexOf(handle) < shards[s]->published.load(std::memory_order_acquire);
+    }
+
+    // The tag in every handle this table issues, random until
+    // followTag(). Passing the previous manager instance's tag makes this
+    // one's the next, so their handles never match. Call before the table
+    // is shared.
+    uint32_t handleTag() const { return tag; }
+    void followTag(uint32_t previous) { tag = (previous + 1) % TAG_COUNT; }
+
+    // Preallocates for `nodes` records: record memory is mapped in one
+    // piece per shard and the ID indexes are sized so they never have to
+    // grow (and briefly double) below that. The table still grows past it.
+    // Call before the table is shared.
+    void reserve(size_t nodes);
+
+    size_t size() const;
+    uint32_t shardCount() const { return (uint32_t)shards.size(); }
+    size_t shardSize(uint32_t shard) const { return shards[shard]->published.load(std::memory_order_acquire); }
+
+    static uint32_t shardOf(uint32_t handle) { return (handle >> INDEX_BITS) & (MAX_SHARDS - 1); }
+    static uint32_t indexOf(uint32_t handle) { return handle & (MAX_SHARD_NODES - 1); }
+
+    // Calls fn(const NodeView &) for every published record, shard by
+    // shard and in handle order within a shard
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (uint32_t s = 0; s < shards.size(); s++) {
+            const Shard &shard = *shards[s];
+            uint32_t count = shard.published.load(std::memory_order_acquire);
+            for (uint32_t b = 0; b * BLOCK_RECORDS < count; b++) {
+                const Block &block = *shard.blocks[b].load(std::memory_order_acquire);
+                uint32_t n = std::min(count - b * BLOCK_RECORDS, uint32_t(BLOCK_RECORDS));
+                for (uint32_t i = 0; i < n; i++) fn(readRecord(block, i, makeHandle(s, b * BLOCK_RECORDS + i)));
+            }
+        }
+    }
+
+    // Records are stored in blocks of BLOCK_RECORDS; block b of a shard
+    // holds indexes b * BLOCK_RECORDS onwards
+    uint32_t blockCount(uint32_t shard) const {
+        return (uint32_t)((shardSize(shard) + BLOCK_RECORDS - 1) / BLOCK_RECORDS);
+    }
+    static uint32_t blockOfHandle(uint32_t handle) { return indexOf(handle) / BLOCK_RECORDS; }
+
+    // The failure rules for one block: active nodes last seen at or before
+    // suspect_cutoff become suspect, and suspect or joining nodes last
+    // seen at or before fail_cutoff fail. Streams through the last_seen array
+    // and only looks at status for candidates. Returns the number of
+    // transitions and, in `oldest`, what is left to time out.
+    size_t expireBlock(uint32_t shard, uint32_t block, int64_t suspect_cutoff, int64_t fail_cutoff,
+                       int64_t now, OldestSeen &oldest);
+
+    // expireBlock() for every block. Returns the number of transitions.
+    size_t sweep(int64_t suspect_cutoff, int64_t fail_cutoff, int64_t now);
+
+    // Occupancy summed over all shards: record blocks (a slab of blocks,
+    // reported in records) and index slots
+    SlabStats recordStats() const;
+    SlabStats indexStats() const;
+
+private:
+    // Parallel arrays for BLOCK_RECORDS consecutive records of a shard
+    struct Block {
+        std::atomic<uint32_t> last_seen[BLOCK_RECORDS]; // pack(t, SEEN_UNIT)
+        std::atomic<uint32_t> since[BLOCK_RECORDS];     // pack(t, SINCE_UNIT)
+        std::atomic<uint32_t> state[BLOCK_RECORDS];     // status | seqlock sequence
+        std::atomic<uint32_t> version[BLOCK_RECORDS];   // low bits of the change epoch
+        std::atomic<uint64_t> dirty[BLOCK_RECORDS / 64]; // changed since the last harvest
+        NodeId ids[BLOCK_RECORDS];
+    };
+
+    // The state word: the status in its low bits, the seqlock sequence
+    // above them. WRITING is the sequence's lowest bit, set while a write
+    // is in progress.
+    static const uint32_t STATUS_MASK = 7;
+    static const uint32_t WRITING = 8;
+    static NodeStatus statusOf(uint32_t state) { return NodeStatus(state & STATUS_MASK); }
+
+    static const int64_t SEEN_UNIT = 1000000;     // ns
+    static const int64_t SINCE_UNIT = 1000000000; // ns
+    static int64_t floorDiv(int64_t t, int64_t unit) { return t >= 0 ? t / unit : -((-t + unit - 1) / unit); }
+    static uint32_t pack(int64_t t, int64_t unit) { return (uint32_t)floorDiv(t, unit); }
+    // The time nearest `near` that packs to `stored`
+    static int64_t unpack(uint32_t stored, int64_t unit, int64_t near) {
+        int64_t ref = floorDiv(near, unit);
+        return (ref + (int32_t)(stored - (uint32_t)ref)) * unit;
+    }
+
+    // One index entry. Slots are probed linearly from hash & mask; Robin
+    // Hood insertion keeps every entry within a short distance of its home
+    // slot, so a miss stops as soon as it passes entries closer to home.
+    struct IndexSlot {
+        uint32_t hash;
+        uint32_t index; // record index, EMPTY_SLOT if unused
+    };
+    static const uint32_t EMPTY_SLOT = 0xFFFFFFFF;
+
+    struct Shard {
+        Shard();
+        ~Shard();
+
+        const NodeId &id(uint32_t i) const { return blocks[i / BLOCK_RECORDS].load()->ids[i % BLOCK_RECORDS]; }
+        uint32_t lookup(const NodeId &id, uint32_t hash);
+        void insert(uint32_t hash, uint32_t index);
+        void place(IndexSlot entry);
+        void growIndex();
+        void resizeIndex(size_t slot_count);
+
+        std::mutex mutex;                          // guards the index and appends
+        SlabPool block_slab;
+        std::atomic<Block *> blocks[MAX_BLOCKS] = {};
+        uint32_t count = 0;                        // records in use
+        std::vector<IndexSlot> slots;              // power-of-two sized
+        std::atomic<uint32_t> published{0};        // count, for lock-free readers
+        std::atomic<uint64_t> dirty_blocks[MAX_BLOCKS / 64] = {}; // blocks with a dirty bit set
+    };
+
+    // Handles whose dirty bit was harvested when `epoch` closed
+    struct EpochChanges {
+        uint64_t epoch;
+        std::vector<uint32_t> handles;
+    };
+
+    static uint32_t hashId(std::string_view id);
+    uint32_t shardFor(uint32_t hash) const;
+    Block &blockOf(uint32_t handle) const {
+        return *shards[shardOf(handle)]->blocks[indexOf(handle) / BLOCK_RECORDS].load(std::memory_order_acquire);
+    }
+
+    static const int64_t KEEP_SEEN = INT64_MIN;
+
+    // Moves record i of block from `from` to `to` as of `at`, also setting
+    // last_seen to `seen` unless it is KEEP_SEEN, if nobody changed the
+    // status first; on failure `from` holds the current status and
+    // nothing was written
+    bool transition(Block &block, uint32_t i, uint32_t handle, NodeStatus &from, NodeStatus to, int64_t at,
+                    int64_t seen = KEEP_SEEN);
+    NodeView readRecord(const Block &block, uint32_t i, uint32_t handle) const {
+        uint32_t state, seen, since, version;
+        do {
+            state = block.state[i].load(std::memory_order_acquire);
+            seen = block.last_seen[i].load(std::memory_order_relaxed);
+            since = block.since[i].load(std::memory_order_relaxed);
+            version = block.version[i].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((state & WRITING) || block.state[i].load(std::memory_order_relaxed) != state);
+
+        int64_t now = LivenessClock::now();
+        uint64_t epoch = change_epoch.load(std::memory_order_relaxed);
+        NodeView view{handle, block.ids[i].view(), 0, statusOf(state), unpack(since, SINCE_UNIT, now),
+                      epoch + (int32_t)(version - (uint32_t)epoch)};
+        bool live = view.status == NodeStatus::Active || view.status == NodeStatus::Joining;
+        view.last_seen = unpack(seen, SEEN_UNIT, live ? now : view.since);
+        return view;
+    }
+    void markChanged(Block &block, uint32_t i, uint32_t handle);
+    void harvestChanges(std::vector<uint32_t> &changed);
+    void revive(Block &block, uint32_t i, uint32_t handle, NodeStatus from, int64_t now);
+    size_t expireRecord(Block &block, uint32_t i, uint32_t handle, int64_t suspect_cutoff,
+                        int64_t fail_cutoff, int64_t now);
+    void notify(const NodeEvent &event) const;
+
+    uint32_t makeHandle(uint32_t shard, uint32_t index) const {
+        return (tag << (SHARD_BITS + INDEX_BITS)) | (shard << INDEX_BITS) | index;
+    }
+
+    uint32_t tag;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::pair<uint64_t, NodeListener>> listeners; // by token
+    uint64_t next_listener = 0;
+
+    std::atomic<uint64_t> change_epoch{1};
+    std::mutex changes_mutex;            // guards the log and harvesting
+    std::deque<EpochChanges> change_log; // oldest first, empty epochs left out
+    size_t logged = 0;                   // handles in change_log
+    uint64_t log_start = 1;              // every closed epoch from here on is in the log
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef PROTOCOL_HPP
+#define PROTOCOL_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// ----------------------------------------------------
+// Binary heartbeat protocol
+//
+// A connection starts in the text protocol. The manager answers REGISTER
+// with "OK <handle>"; later heartbeats carry that handle ("HB <handle>" or
+// a frame) and a stale one is answered with "REREGISTER". A REGISTER that
+// can never succeed (the ID does not fit, the table is full) is answered
+// "REJECTED <reason>" instead, and one to retry later "RETRY <ms>". A
+// worker that can speak binary sends "PROTO <version>" after REGISTER; a
+// manager that supports it answers "PROTO <version>" and from then on the
+// worker sends fixed-layout frames. Old managers ignore the PROTO line and
+// old workers never send it, so both sides fall back to text on their own.
+//
+// Frames are little-endian, 32 bytes, optionally followed by `length` bytes
+// of payload.
+//
+// A relay speaks the same protocol upstream for a whole rack: it registers
+// as a node itself and, once per interval, sends one HEARTBEAT_BATCH frame
+// whose payload is the u32 handles of every worker it heard from. The
+// manager answers each stale handle in it with "REREGISTER <handle>".
+//
+// A worker that shuts down on purpose says so with "LEAVE <handle>" or a
+// LEAVE frame, so the manager marks it left instead of failing it later.
+//
+// A watcher polls with "CHANGES <epoch>", 0 the first time. The reply is
+// "CHANGES <next> <count>" and then <count> lines "NODE <id> <status>
+// <since>" (since in Unix seconds), one per node added or changed status
+// since <epoch>; the next poll passes <next>.
+// ----------------------------------------------------
+
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "frames are sent in host order");
+
+const uint16_t FRAME_MAGIC = 0xCB5A;
+const uint8_t PROTOCOL_VERSION = 1;
+const uint32_t NO_HANDLE = 0xFFFFFFFF; // never issued by REGISTER
+
+enum FrameType : uint8_t {
+    FRAME_HEARTBEAT = 1,
+    FRAME_HEARTBEAT_BATCH = 2, // payload: uint32_t handles, length / 4 of them
+    FRAME_LEAVE = 3,
+};
+
+struct Frame {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;
+    uint32_t handle;   // node handle returned by REGISTER
+    uint64_t seq;      // per-node, monotonically increasing
+    uint64_t sent_ns;  // sender's monotonic clock at send time
+    uint32_t length;   // payload bytes that follow the header
+    uint32_t reserved;
+};
+static_assert(sizeof(Frame) == 32, "Frame layout is part of the wire protocol");
+
+inline Frame makeFrame(FrameType type, uint32_t handle, uint64_t seq, uint64_t sent_ns) {
+    Frame f{};
+    f.magic = FRAME_MAGIC;
+    f.version = PROTOCOL_VERSION;
+    f.type = type;
+    f.handle = handle;
+    f.seq = seq;
+    f.sent_ns = sent_ns;
+    return f;
+}
+
+// Streaming frame decoder. Complete frames are decoded straight out of the
+// receive buffer; only a frame split across reads is copied, into a small
+// inline carry buffer (or the heap for the rare oversized payload).
+class FrameDecoder {
+public:
+    static const uint32_t MAX_PAYLOAD = 64 * 1024;
+
+    // Calls on_frame(const Frame &, const char *payload) for every complete
+    // frame. Returns false on a bad magic/version or oversized payload; the
+    // stream cannot be resynchronised and should be closed.
+    template <typename Fn>
+    bool feed(const char *data, size_t len, Fn &&on_frame) {
+        const char *p = data;
+        const char *end = data + len;
+
+        // Finish a frame left over from the previous read: top up the
+        // header first, then its payload.
+        while (carry_len > 0) {
+            size_t want = sizeof(Frame) - carry_len;
+            if (carry_len >= sizeof(Frame)) {
+                Frame f;
+                memcpy(&f, carryData(), sizeof(Frame));
+                if (!valid(f)) return false;
+                size_t total = sizeof(Frame) + f.length;
+                if (carry_len == total) {
+                    on_frame(f, carryData() + sizeof(Frame));
+                    carry_len = 0;
+                    spill.clear();
+                    break;
+                }
+                want = total - carry_len;
+            }
+            size_t take = std::min(want, (size_t)(end - p));
+            if (take == 0) return true;
+            append(p, take);
+            p += take;
+        }
+
+        while ((size_t)(end - p) >= sizeof(Frame)) {
+            Frame f;
+            memcpy(&f, p, sizeof(Frame));
+            if (!valid(f)) return false;
+            if ((size_t)(end - p) < sizeof(Frame) + f.length) break;
+            on_frame(f, p + sizeof(Frame));
+            p += sizeof(Frame) + f.length;
+        }
+
+        append(p, end - p);
+        return true;
+    }
+
+private:
+    static const size_t INLINE_CARRY = sizeof(Frame);
+
+    static bool valid(const Frame &f) {
+        return f.magic == FRAME_MAGIC && f.version == PROTOCOL_VERSION && f.length <= MAX_PAYLOAD;
+    }
+
+    const char *carryData() const { return spill.empty() ? carry : spill.data(); }
+
+    void append(const char *p, size_t n) {
+        if (n == 0) return;
+        if (carry_len + n <= INLINE_CARRY && spill.empty()) {
+            memcpy(carry + carry_len, p, n);
+        } else {
+            if (spill.empty()) spill.assign(carry, carry + carry_len);
+            spill.insert(spill.end(), p, p + n);
+        }
+        carry_len += n;
+    }
+
+    uint32_t carry_len = 0;
+    char carry[INLINE_CARRY];
+    std::vector<char> spill;
+};
+
+#endif
@@ -0,0 +1,339 @@
+// reactor.cpp
+#include "reactor.hpp"
+#include "uring_reactor.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+extern Logger logger;
+
+const int MAX_EVENTS = 256;
+const int EPOLL_TIMEOUT_MS = 1000; // how often the loop re-checks the stop flag
+const size_t READ_CHUNK = 4096;
+
+// ----------------------------------------------------
+// Connection output
+// ----------------------------------------------------
+bool Connection::write(std::string_view data) {
+    if (write_failed) return false;
+    while (!unsent && !data.empty()) {
+        ssize_t n = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (n > 0) {
+            data.remove_prefix(n);
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            write_failed = true;
+            return false;
+        }
+    }
+    if (data.empty()) return true;
+    if (!unsent) unsent.reset(new Unsent());
+    if (unsent->data.size() - unsent->sent + data.size() > MAX_UNSENT) {
+        write_failed = true;
+        return false;
+    }
+    unsent->data.append(data);
+    return true;
+}
+
+bool Connection::flushUnsent() {
+    while (unsent) {
+        ssize_t n = send(fd, unsent->data.data() + unsent->sent, unsent->data.size() - unsent->sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            unsent->sent += n;
+            if (unsent->sent == unsent->data.size()) unsent.reset();
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return true;
+        } else {
+            write_failed = true;
+            return false;
+        }
+    }
+    return true;
+}
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+// Every idle worker holds one descriptor, so lift the soft limit as far as
+// the hard limit allows.
+void raiseFdLimit() {
+    rlimit lim{};
+    if (getrlimit(RLIMIT_NOFILE, &lim) == 0 && lim.rlim_cur < lim.rlim_max) {
+        lim.rlim_cur = lim.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &lim);
+    }
+}
+
+// ----------------------------------------------------
+// Connection bookkeeping shared by all backends. Connection objects come
+// from one slab shared by every reactor; it is only touched on accept and
+// close, so a plain mutex is enough. The pool is never destroyed, so
+// reactor threads still running at exit() do not lose their connections.
+// ----------------------------------------------------
+static SlabPool &connection_slab = *new SlabPool(sizeof(Connection));
+static std::mutex connection_slab_mutex;
+
+SlabStats connectionSlabStats() {
+    std::lock_guard<std::mutex> lock(connection_slab_mutex);
+    return connection_slab.stats();
+}
+
+Reactor::Reactor(DataHandler on_data) : on_data(std::move(on_data)) {
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+Reactor::~Reactor() {
+    if (wake_fd >= 0) close(wake_fd);
+    if (reserve_fd >= 0) close(reserve_fd);
+    for (Connection *conn : connections) {
+        if (!conn) continue;
+        close(conn->fd);
+        std::lock_guard<std::mutex> lock(connection_slab_mutex);
+        connection_slab.destroy(conn);
+    }
+}
+
+Connection *Reactor::openConnection(int fd) {
+    if ((size_t)fd >= connections.size()) {
+        connections.resize(fd + 1, nullptr);
+    }
+    {
+        std::lock_guard<std::mutex> lock(connection_slab_mutex);
+        connections[fd] = connection_slab.create<Connection>();
+    }
+    connections[fd]->fd = fd;
+    connections[fd]->serial = ++next_serial;
+    open_connections++;
+    return connections[fd];
+}
+
+Connection *Reactor::findConnection(int fd) {
+    return (size_t)fd < connections.size() ? connections[fd] : nullptr;
+}
+
+void Reactor::post(ConnectionRef ref, ConnectionTask task) {
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex);
+        posted.emplace_back(ref, std::move(task));
+    }
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0) {} // already readable if the counter is saturated
+}
+
+void Reactor::runPosted() {
+    uint64_t count;
+    if (read(wake_fd, &count, sizeof(count)) < 0) {} // resets the counter
+    std::vector<std::pair<ConnectionRef, ConnectionTask>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(posted_mutex);
+        tasks.swap(posted);
+    }
+    for (auto &[ref, task] : tasks) {
+        Connection *conn = findConnection(ref.fd);
+        if (!conn || conn->serial != ref.serial) continue;
+        task(*conn);
+        settle(*conn);
+    }
+}
+
+bool Reactor::shedConnection(int listen_fd) {
+    if (reserve_fd < 0) return false;
+    // The listener may be blocking (io_uring); only accept what is pending
+    pollfd pfd{listen_fd, POLLIN, 0};
+    if (poll(&pfd, 1, 0) != 1) return false;
+    close(reserve_fd);
+    int sock = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (sock >= 0) close(sock);
+    reserve_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    return sock >= 0;
+}
+
+void Reactor::dropConnection(int fd) {
+    Connection *conn = findConnection(fd);
+    if (!conn) return;
+    close(fd);
+    connections[fd] = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(connection_slab_mutex);
+        connection_slab.destroy(conn);
+    }
+    open_connections--;
+}
+
+// ----------------------------------------------------
+// epoll backend
+// ----------------------------------------------------
+EpollReactor::EpollReactor(int listen_fd, DataHandler on_data)
+    : Reactor(std::move(on_data)), listen_fd(listen_fd) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        logger.warn(std::string("epoll_create1 failed: ") + strerror(errno));
+        return;
+    }
+    setNonBlocking(listen_fd);
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd();
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeFd(), &ev);
+}
+
+EpollReactor::~EpollReactor() {
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+// Accept every pending connection (edge-triggered, so drain to EAGAIN).
+// Without descriptors the backlog is drained by turning connections away:
+// an edge-triggered listener would not report them again.
+void EpollReactor::acceptAll() {
+    size_t shed = 0;
+    while (true) {
+        int client_sock = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_sock < 0) {
+            int err = errno;
+            if (err == EINTR || err == ECONNABORTED) continue;
+            bool exhausted = err == EMFILE || err == ENFILE;
+            if (exhausted && shedConnection(listen_fd)) {
+                shed++;
+                continue;
+            }
+            if (shed > 0) {
+                logger.warn("Out of file descriptors: turned away " + std::to_string(shed) + " connection(s)");
+            }
+            if (err != EAGAIN && err != EWOULDBLOCK && !exhausted) {
+                logger.warn(std::string("accept failed: ") + strerror(err));
+            }
+            return;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = client_sock;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, client_sock, &ev) < 0) {
+            close(client_sock);
+            continue;
+        }
+        openConnection(client_sock);
+    }
+}
+
+// Drains a readable socket. Returns false once the peer is gone.
+bool EpollReactor::readAll(Connection &conn) {
+    char buffer[READ_CHUNK];
+    while (true) {
+        ssize_t bytes_read = read(conn.fd, buffer, sizeof(buffer));
+        if (bytes_read > 0) {
+            if (!on_data(conn, buffer, bytes_read)) return false;
+            continue;
+        }
+        if (bytes_read < 0 && errno == EINTR) continue;
+        return bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+void EpollReactor::settle(Connection &conn) {
+    if (conn.write_failed) {
+        closeConnection(conn.fd);
+        return;
+    }
+    bool wanted = conn.unsent != nullptr;
+    if (wanted == conn.write_armed) return;
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET | (wanted ? EPOLLOUT : 0);
+    ev.data.fd = conn.fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.write_armed = wanted;
+}
+
+void EpollReactor::closeConnection(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    dropConnection(fd);
+}
+
+void EpollReactor::run(const volatile sig_atomic_t &stop) {
+    if (epoll_fd < 0) return;
+    epoll_event events[MAX_EVENTS];
+
+    while (!stop) {
+        int n = epoll_wait(epoll_fd, events, MAX_EVENTS, EPOLL_TIMEOUT_MS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            logger.warn(std::string("epoll_wait failed: ") + strerror(errno));
+            break;
+        }
+        LivenessClock::tick(); // once per pass; handlers use LivenessClock::now()
+
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd) {
+                acceptAll();
+                continue;
+            }
+            if (fd == wakeFd()) {
+                runPosted();
+                continue;
+            }
+
+            Connection *conn = findConnection(fd);
+            if (!conn) continue;
+
+            // Always drain what is buffered, even if the peer already hung up
+            bool keep_open = conn->flushUnsent() && readAll(*conn);
+            if (!keep_open || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+                closeConnection(fd);
+            } else {
+                settle(*conn);
+            }
+        }
+    }
+}
+
+// ----------------------------------------------------
+// Backend selection
+// ----------------------------------------------------
+Backend resolveBackend(Backend backend) {
+    if (backend == Backend::Auto) {
+        return UringReactor::supported() ? Backend::Uring : Backend::Epoll;
+    }
+    if (backend == Backend::Uring && !UringReactor::supported()) {
+        logger.warn("io_uring backend not supported by this kernel, falling back to epoll");
+        return Backend::Epoll;
+    }
+    return backend;
+}
+
+const char *backendName(Backend backend) {
+    switch (backend) {
+        case Backend::Epoll: return "epoll";
+        case Backend::Uring: return "io_uring";
+        default: return "auto";
+    }
+}
+
+std::unique_ptr<Reactor> makeReactor(Backend backend, int listen_fd, DataHandler on_data) {
+    if (resolveBackend(backend) == Backend::Uring) {
+        return std::unique_ptr<Reactor>(new UringReactor(listen_fd, std::move(on_data)));
+    }
+    return std::unique_ptr<Reactor>(new EpollReactor(listen_fd, std::move(on_data)));
+}
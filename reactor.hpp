@@ -0,0 +1,269 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include "coro_task.hpp"
+#include "line_framer.hpp"
+#include "protocol.hpp"
+#include "slab.hpp"
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct Connection;
+
+// A complete text line, as a view into the receive buffer
+struct TextLine {
+    std::string_view text;
+    size_t verb_len; // offset of the first space, or text.size()
+};
+
+// A complete binary frame and its payload, valid until the next co_await
+struct FrameView {
+    const Frame *frame;
+    const char *payload;
+};
+
+// Awaitables for the connection coroutine. They always suspend; the data
+// handler resumes the coroutine once the framer or decoder has the next
+// complete message.
+struct LineAwaiter {
+    Connection &conn;
+    bool await_ready() noexcept; // a parked line is ready at once
+    void await_suspend(std::coroutine_handle<> h) noexcept;
+    TextLine await_resume() const noexcept;
+};
+
+struct FrameAwaiter {
+    Connection &conn;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept;
+    FrameView await_resume() const noexcept;
+};
+
+// Waits for complete(), typically from a task another thread posted
+struct ReplyAwaiter {
+    Connection &conn;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept;
+    std::string await_resume() const;
+};
+
+// Names a connection for another thread. The fd alone is not enough: by
+// the time the other thread is done, it may belong to a newer connection.
+struct ConnectionRef {
+    int fd;
+    uint64_t serial;
+};
+
+// Per-connection state owned by the reactor. A connection speaks the text
+// protocol until it negotiates binary frames; either decoder keeps a
+// message that was split across reads until the rest of it shows up.
+//
+// The protocol itself runs as a coroutine per connection that reads one
+// message at a time with co_await readLine() / readFrame(). It lives on
+// the reactor thread, so an idle connection costs this struct plus a
+// pooled coroutine frame rather than a thread.
+//
+// The coroutine may also wait for something other than the peer, e.g. a
+// reply another thread fetches (awaitReply()). Lines arriving meanwhile
+// are parked in order and handed out by the next readLine()s.
+//
+// Replies go out through write(). Whatever the socket does not take at
+// once is queued and sent by the reactor as the socket drains, so a large
+// reply reaches a slow reader whole; a peer that lets more than
+// MAX_UNSENT pile up is disconnected.
+struct Connection {
+    enum class Wait : uint8_t { Line, Frame, Reply };
+    static const size_t MAX_UNSENT = 128 * 1024 * 1024;
+
+    int fd;
+    bool registered = false; // REGISTER was admitted on this connection
+    bool binary = false;
+    Wait waiting_for = Wait::Line; // what the coroutine is suspended in
+    bool write_armed = false;      // the reactor waits for the socket to drain
+    bool write_failed = false;     // peer gone or too much unsent; the reactor closes it
+    uint64_t serial = 0;           // unique per reactor, see ConnectionRef
+    LineFramer framer;
+    FrameDecoder decoder;
+
+    Task handler;                    // the protocol coroutine, started on first data
+    std::coroutine_handle<> waiting; // set while it is suspended
+    TextLine line{};
+    FrameView frame{};
+    std::string parked;      // lines received during awaitReply(), '\n'-terminated
+    size_t parked_read = 0;  // how far readLine() has handed them out
+
+    struct Unsent {
+        std::string data;
+        size_t sent = 0;
+    };
+    std::unique_ptr<Unsent> unsent; // only while output is queued
+
+    // Sends now or queues; false once the connection is failing
+    bool write(std::string_view data);
+    // Sends queued output until the socket is full; false on error
+    bool flushUnsent();
+
+    LineAwaiter readLine() { return {*this}; }
+    FrameAwaiter readFrame() { return {*this}; }
+    ReplyAwaiter awaitReply() { return {*this}; }
+    ConnectionRef ref() const { return {fd, serial}; }
+
+    // Hand the next message to the coroutine and run it until it suspends
+    // again. A message of the other kind (a line left in the same read as
+    // a binary switch) is dropped.
+    void deliver(TextLine next) {
+        if (waiting_for == Wait::Reply) {
+            parked.append(next.text);
+            parked += '\n';
+            return;
+        }
+        line = next;
+        if (waiting_for == Wait::Line) resume();
+    }
+    void deliver(FrameView next) {
+        frame = next;
+        if (waiting_for == Wait::Frame) resume();
+    }
+    // Resumes an awaitReply() with `reply`
+    void complete(std::string_view reply) {
+        if (waiting_for != Wait::Reply) return;
+        line = TextLine{reply, 0};
+        waiting_for = Wait::Line;
+        resume();
+    }
+
+    // Takes the next parked line, if any; the view stays valid until the
+    // coroutine suspends again
+    bool unpark() {
+        if (parked_read == parked.size()) {
+            parked.clear();
+            parked_read = 0;
+            return false;
+        }
+        size_t nl = parked.find('\n', parked_read);
+        std::string_view text(parked.data() + parked_read, nl - parked_read);
+        size_t space = text.find(' ');
+        line = TextLine{text, space == std::string_view::npos ? text.size() : space};
+        parked_read = nl + 1;
+        return true;
+    }
+
+private:
+    void resume() {
+        std::coroutine_handle<> h = waiting;
+        waiting = nullptr;
+        if (h) h.resume();
+    }
+};
+
+inline bool LineAwaiter::await_ready() noexcept { return conn.unpark(); }
+inline void LineAwaiter::await_suspend(std::coroutine_handle<> h) noexcept {
+    conn.waiting = h;
+    conn.waiting_for = Connection::Wait::Line;
+}
+inline TextLine LineAwaiter::await_resume() const noexcept { return conn.line; }
+inline void FrameAwaiter::await_suspend(std::coroutine_handle<> h) noexcept {
+    conn.waiting = h;
+    conn.waiting_for = Connection::Wait::Frame;
+}
+inline FrameView FrameAwaiter::await_resume() const noexcept { return conn.frame; }
+inline void ReplyAwaiter::await_suspend(std::coroutine_handle<> h) noexcept {
+    conn.waiting = h;
+    conn.waiting_for = Connection::Wait::Reply;
+}
+inline std::string ReplyAwaiter::await_resume() const { return std::string(conn.line.text); }
+
+// Called with every chunk of bytes received on a connection. Returns false
+// when the connection should be closed.
+using DataHandler = std::function<bool(Connection &, const char *data, size_t len)>;
+
+enum class Backend { Auto, Epoll, Uring };
+
+// An event loop that owns one listening socket and every connection accepted
+// from it. Backends only differ in how they wait for and receive bytes; the
+// protocol lives entirely in the data handler.
+class Reactor {
+public:
+    explicit Reactor(DataHandler on_data);
+    virtual ~Reactor();
+
+    virtual void run(const volatile sig_atomic_t &stop) = 0;
+    size_t connectionCount() const { return open_connections; }
+
+    // Runs task on the reactor thread with the connection, unless it has
+    // closed by then. Safe to call from any thread.
+    using ConnectionTask = std::function<void(Connection &)>;
+    void post(ConnectionRef ref, ConnectionTask task);
+
+protected:
+    Connection *openConnection(int fd);
+    Connection *findConnection(int fd);
+    void dropConnection(int fd); // closes the socket
+
+    // Readable once post() has queued tasks; the loop watches it and
+    // calls runPosted()
+    int wakeFd() const { return wake_fd; }
+    void runPosted();
+
+    // Out of descriptors (EMFILE/ENFILE): accepts one pending connection
+    // on the reserve descriptor and closes it at once, so the backlog
+    // drains instead of stalling. Returns false if none was pending.
+    bool shedConnection(int listen_fd);
+
+    // After handler code ran for conn: waits for the socket to drain if
+    // output is queued, or closes the connection if a write failed. conn
+    // may be gone afterwards.
+    virtual void settle(Connection &conn) = 0;
+
+    DataHandler on_data;
+
+private:
+    std::vector<Connection *> connections; // indexed by fd, from the connection slab
+    size_t open_connections = 0;
+    uint64_t next_serial = 0;
+
+    int wake_fd;    // eventfd
+    int reserve_fd; // held open so shedConnection() always has one to spare
+    std::mutex posted_mutex;
+    std::vector<std::pair<ConnectionRef, ConnectionTask>> posted;
+};
+
+// Single-threaded, edge-triggered epoll loop. Readable sockets are drained
+// until EAGAIN and every chunk is handed to the data handler.
+class EpollReactor : public Reactor {
+public:
+    EpollReactor(int listen_fd, DataHandler on_data);
+    ~EpollReactor() override;
+
+    void run(const volatile sig_atomic_t &stop) override;
+
+private:
+    void settle(Connection &conn) override;
+    void acceptAll();
+    bool readAll(Connection &conn);
+    void closeConnection(int fd);
+
+    int listen_fd;
+    int epoll_fd;
+};
+
+// Creates the requested backend. Auto picks io_uring when the running kernel
+// supports everything it needs and falls back to epoll otherwise.
+std::unique_ptr<Reactor> makeReactor(Backend backend, int listen_fd, DataHandler on_data);
+Backend resolveBackend(Backend backend);
+const char *backendName(Backend backend);
+
+// Occupancy of the slab every reactor takes its Connection objects from
+SlabStats connectionSlabStats();
+
+bool setNonBlocking(int fd);
+void raiseFdLimit();
+
+#endif
@@ -0,0 +1,489 @@
+// relay.cpp - per-rack heartbeat relay
+//
+// Workers connect to the relay exactly as they would to the manager. The
+// relay forwards each REGISTER upstream so workers get real manager
+// handles, answers heartbeats itself, and once per interval sends the
+// manager a single HEARTBEAT_BATCH frame listing every handle it heard
+// from. The manager then holds one connection per rack instead of one per
+// worker.
+//
+// The reactor thread never talks to the manager itself: batches go out on
+// the uplink thread and forwarded control messages on the control thread.
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_set>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "logger.hpp"
+#include "reactor.hpp"
+#include "command.hpp"
+
+Logger logger("relay.log");
+
+const char *USAGE = "Usage: ./relay [--id NAME] [--port N] [--upstream HOST:PORT] [--interval-ms N] [--backend auto|epoll|uring]";
+const int RETRY_INTERVAL = 3;          // seconds between upstream connection attempts
+const int UPSTREAM_TIMEOUT_MS = 2000;  // how long a connect or a forwarded REGISTER may take
+const int UNAVAILABLE_RETRY_MS = 3000; // told to workers while the manager is unreachable
+
+// Command line options
+struct RelayOptions {
+    std::string id = "relay";  // registered upstream as "relay:<id>"
+    int port = 5051;
+    std::string upstream_host = "127.0.0.1";
+    int upstream_port = 5050;
+    int interval_ms = 1000;    // one batch per interval
+    Backend backend = Backend::Auto;
+};
+RelayOptions options;
+
+volatile sig_atomic_t shutdown_requested = 0;
+
+void signalHandler(int) {
+    shutdown_requested = 1;
+}
+
+// ----------------------------------------------------
+// State shared by the reactor thread and the uplink thread
+// ----------------------------------------------------
+std::mutex relay_mutex;
+std::unordered_set<uint32_t> live_handles;  // heard from since the last batch
+std::unordered_set<uint32_t> stale_handles; // the manager wants these re-registered
+std::atomic<uint64_t> heartbeats_relayed{0};
+std::atomic<uint64_t> batches_sent{0};
+std::atomic<size_t> last_batch_size{0};
+
+// ----------------------------------------------------
+// A blocking connection to the manager, with a buffer for its replies
+// ----------------------------------------------------
+struct Upstream {
+    int fd = -1;
+    std::string buffer;
+
+    // Gives up after UPSTREAM_TIMEOUT_MS rather than the kernel's SYN
+    // timeout when the manager's host does not answer
+    bool open() {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(options.upstream_port);
+        inet_pton(AF_INET, options.upstream_host.c_str(), &addr.sin_addr);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        bool ok = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        if (!ok && errno == EINPROGRESS) {
+            pollfd pfd{fd, POLLOUT, 0};
+            int error = 0;
+            socklen_t len = sizeof(error);
+            ok = poll(&pfd, 1, UPSTREAM_TIMEOUT_MS) == 1 &&
+                 getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &len) == 0 && error == 0;
+        }
+        if (ok && fcntl(fd, F_SETFL, flags) == 0) return true;
+        reset();
+        return false;
+    }
+
+    void reset() {
+        if (fd >= 0) close(fd);
+        fd = -1;
+        buffer.clear();
+    }
+
+    bool sendAll(const char *data, size_t len) {
+        while (len > 0) {
+            ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            data += n;
+            len -= n;
+        }
+        return true;
+    }
+    bool sendAll(const std::string &s) { return sendAll(s.data(), s.size()); }
+
+    // Waits at most timeout_ms for a whole line (returned without '\n').
+    // Returns false on timeout or when the connection is gone; the caller
+    // tells the two apart with connected().
+    bool readLine(std::string &line, int timeout_ms) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        while (true) {
+            size_t nl = buffer.find('\n');
+            if (nl != std::string::npos) {
+                line = trim(std::string_view(buffer).substr(0, nl));
+                buffer.erase(0, nl + 1);
+                return true;
+            }
+            int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            pollfd pfd{fd, POLLIN, 0};
+            if (poll(&pfd, 1, std::max(remaining, 0)) <= 0) return false;
+
+            char chunk[4096];
+            ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                reset();
+                return false;
+            }
+            buffer.append(chunk, n);
+        }
+    }
+
+    bool connected() const { return fd >= 0; }
+};
+
+// ----------------------------------------------------
+// Control link: REGISTER, LEAVE and legacy ID heartbeats, forwarded one
+// at a time by the control thread so a slow or unreachable manager never
+// stalls the reactor. A REGISTER suspends only its worker's coroutine
+// until the manager's reply, which the worker gets verbatim ("OK
+// <handle>", "RETRY <ms>" or "REJECTED <reason>"); heartbeats keep
+// flowing meanwhile.
+// ----------------------------------------------------
+struct ControlRequest {
+    std::string line;      // without '\n'
+    bool wants_reply;      // a REGISTER: hand the reply back to `from`
+    ConnectionRef from;
+};
+
+std::mutex control_mutex;
+std::condition_variable control_cv;
+std::deque<ControlRequest> control_queue;
+Reactor *worker_reactor = nullptr; // resumes workers waiting for a reply
+
+void forwardLine(std::string line, const Connection *from = nullptr) {
+    {
+        std::lock_guard<std::mutex> lock(control_mutex);
+        control_queue.push_back(ControlRequest{std::move(line), from != nullptr,
+                                               from ? from->ref() : ConnectionRef{-1, 0}});
+    }
+    control_cv.notify_one();
+}
+
+void runControl() {
+    Upstream control;
+    const std::string retry = "RETRY " + std::to_string(UNAVAILABLE_RETRY_MS);
+    auto next_attempt = std::chrono::steady_clock::now();
+    while (!shutdown_requested) {
+        ControlRequest request;
+        {
+            std::unique_lock<std::mutex> lock(control_mutex);
+            control_cv.wait_for(lock, std::chrono::seconds(1), [] { return !control_queue.empty(); });
+            if (control_queue.empty()) continue;
+            request = std::move(control_queue.front());
+            control_queue.pop_front();
+        }
+        // After a failed connect, turn requests away for RETRY_INTERVAL
+        // instead of waiting out a connect timeout for each of them
+        auto now = std::chrono::steady_clock::now();
+        if (!control.connected() && now >= next_attempt && !control.open()) {
+            next_attempt = now + std::chrono::seconds(RETRY_INTERVAL);
+        }
+
+        std::string reply = retry;
+        for (int attempt = 0; control.connected(); attempt++) {
+            bool sent = control.sendAll(request.line + "\n");
+            if (sent && (!request.wants_reply || control.readLine(reply, UPSTREAM_TIMEOUT_MS))) break;
+            // On a timeout, drop the link rather than risk pairing a late
+            // reply with the next REGISTER. A write error or EOF means the
+            // manager closed it (e.g. restarted): reconnect once and resend.
+            bool dropped = !sent || !control.connected();
+            control.reset();
+            reply = retry;
+            if (!dropped || attempt > 0) break;
+            logger.warn("Control link to manager lost. Reconnecting...");
+            if (!control.open()) next_attempt = std::chrono::steady_clock::now() + std::chrono::seconds(RETRY_INTERVAL);
+        }
+        if (request.wants_reply) {
+            worker_reactor->post(request.from, [reply](Connection &conn) { conn.complete(reply); });
+        }
+    }
+}
+
+// ----------------------------------------------------
+// Uplink: registers the relay itself, negotiates binary frames, then sends
+// a batch every interval and collects the manager's REREGISTERs.
+// ----------------------------------------------------
+uint32_t registerRelay(Upstream &link) {
+    std::string node_id = "relay:" + options.id;
+    std::string offer = "PROTO " + std::to_string(PROTOCOL_VERSION);
+    while (!shutdown_requested) {
+        link.sendAll("REGISTER " + node_id + "\n" + offer + "\n");
+
+        uint32_t handle = NO_HANDLE;
+        int retry_ms = 0;
+        std::string line;
+        while (link.readLine(line, UPSTREAM_TIMEOUT_MS)) {
+            if (line.rfind("OK ", 0) == 0) handle = parseHandle(std::string_view(line).substr(3));
+            else if (line.rfind("RETRY ", 0) == 0) retry_ms = std::max(1, atoi(line.c_str() + 6));
+            else if (line.rfind("REJECTED ", 0) == 0) {
+                logger.warn("Manager rejected " + node_id + ": " + line.substr(9));
+                return NO_HANDLE;
+            }
+            else if (line == offer && handle != NO_HANDLE) return handle;
+            if (retry_ms > 0) break;
+        }
+        if (retry_ms == 0) return NO_HANDLE; // gone, or a manager without binary frames
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms));
+    }
+    return NO_HANDLE;
+}
+
+// Sends the handles heard from since the last batch, split into frames
+// of at most MAX_PAYLOAD bytes. An empty batch still refreshes the relay.
+bool sendBatch(Upstream &link, uint32_t relay_handle, uint64_t seq) {
+    std::vector<uint32_t> handles;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex);
+        handles.assign(live_handles.begin(), live_handles.end());
+        live_handles.clear();
+    }
+    last_batch_size = handles.size();
+
+    const size_t per_frame = FrameDecoder::MAX_PAYLOAD / sizeof(uint32_t);
+    uint64_t now_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    size_t off = 0;
+    do {
+        size_t n = std::min(per_frame, handles.size() - off);
+        Frame f = makeFrame(FRAME_HEARTBEAT_BATCH, relay_handle, seq, now_ns);
+        f.length = n * sizeof(uint32_t);
+        std::string wire((const char *)&f, sizeof(f));
+        wire.append((const char *)(handles.data() + off), f.length);
+        if (!link.sendAll(wire)) return false;
+        off += n;
+    } while (off < handles.size());
+    batches_sent++;
+    return true;
+}
+
+void runUplink() {
+    Upstream link;
+    uint64_t seq = 0;
+    while (!shutdown_requested) {
+        if (!link.open()) {
+            logger.warn("Manager unavailable. Retrying in " + std::to_string(RETRY_INTERVAL) + "s...");
+            std::this_thread::sleep_for(std::chrono::seconds(RETRY_INTERVAL));
+            continue;
+        }
+        uint32_t relay_handle = registerRelay(link);
+        if (relay_handle == NO_HANDLE) {
+            logger.warn("Manager did not accept the relay's REGISTER/PROTO. Retrying...");
+            link.reset();
+            std::this_thread::sleep_for(std::chrono::seconds(RETRY_INTERVAL));
+            continue;
+        }
+        logger.info("Relaying to " + options.upstream_host + ":" + std::to_string(options.upstream_port) +
+                    " as handle " + std::to_string(relay_handle));
+
+        auto interval = std::chrono::milliseconds(options.interval_ms);
+        auto next_batch = std::chrono::steady_clock::now() + interval;
+        bool reregister = false;
+        while (!shutdown_requested && link.connected() && !reregister) {
+            int wait_ms = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+                next_batch - std::chrono::steady_clock::now()).count();
+            std::string line;
+            if (link.readLine(line, std::max(wait_ms, 0))) {
+                Command cmd = splitCommand(line, std::min(line.find(' '), line.size()));
+                if (cmd.verb == "REREGISTER" && cmd.arg.empty()) {
+                    reregister = true; // our own handle is stale
+                } else if (cmd.verb == "REREGISTER") {
+                    std::lock_guard<std::mutex> lock(relay_mutex);
+                    stale_handles.insert(parseHandle(cmd.arg));
+                }
+            } else if (!link.connected()) {
+                break;
+            }
+            if (std::chrono::steady_clock::now() < next_batch) continue;
+            if (!sendBatch(link, relay_handle, ++seq)) break;
+            next_batch += interval;
+        }
+        logger.warn(reregister ? "Manager asked the relay to re-register" : "Lost connection to manager");
+        link.reset();
+    }
+}
+
+// ----------------------------------------------------
+// Worker-facing protocol: the manager's, served locally except for
+// REGISTER and legacy ID heartbeats.
+// ----------------------------------------------------
+void sendLine(Connection &conn, const std::string &line) {
+    conn.write(line);
+}
+
+// Queues a handle for the next batch, or tells the worker to re-register
+// if the manager reported it stale
+void noteHeartbeat(Connection &conn, uint32_t handle) {
+    heartbeats_relayed.fetch_add(1, std::memory_order_relaxed);
+    bool stale;
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex);
+        stale = stale_handles.erase(handle) > 0;
+        if (!stale) live_handles.insert(handle);
+    }
+    if (stale) sendLine(conn, "REREGISTER\n");
+}
+
+// A departing worker: drop it from the next batch and pass the LEAVE on
+// over the control link
+void noteLeave(uint32_t handle) {
+    {
+        std::lock_guard<std::mutex> lock(relay_mutex);
+        live_handles.erase(handle);
+    }
+    forwardLine("LEAVE " + std::to_string(handle));
+}
+
+// The manager's answer to a forwarded REGISTER
+void answerRegister(Connection &conn, const std::string &reply) {
+    if (reply.rfind("OK ", 0) == 0) {
+        conn.registered = true;
+        // A fresh handle must not inherit a REREGISTER meant for its slot
+        std::lock_guard<std::mutex> lock(relay_mutex);
+        stale_handles.erase(parseHandle(std::string_view(reply).substr(3)));
+    }
+    sendLine(conn, reply + "\n");
+}
+
+// Every text command except REGISTER, which serveWorker() awaits
+void dispatchLine(Connection &conn, std::string_view line, size_t verb_len) {
+    Command cmd = splitCommand(line, verb_len);
+
+    if (cmd.verb == "HB" && !cmd.arg.empty()) {
+        noteHeartbeat(conn, parseHandle(cmd.arg));
+    }
+    else if (cmd.verb == "HEARTBEAT" && !cmd.arg.empty()) {
+        forwardLine(std::string(trim(line)));
+    }
+    else if (cmd.verb == "LEAVE" && !cmd.arg.empty()) {
+        noteLeave(parseHandle(cmd.arg));
+    }
+    else if (cmd.verb == "PROTO" && conn.registered) {
+        int offered = atoi(std::string(cmd.arg).c_str());
+        if (offered >= PROTOCOL_VERSION) {
+            sendLine(conn, "PROTO " + std::to_string(PROTOCOL_VERSION) + "\n");
+            conn.binary = true;
+        }
+    }
+    else if (cmd.verb == "STATS") {
+        sendLine(conn, "STATS heartbeats=" + std::to_string(heartbeats_relayed.load()) +
+                       " batches=" + std::to_string(batches_sent.load()) +
+                       " last_batch=" + std::to_string(last_batch_size.load()) + "\n");
+    }
+}
+
+Task serveWorker(Connection &conn) {
+    while (!conn.binary) {
+        TextLine line = co_await conn.readLine();
+        Command cmd = splitCommand(line.text, line.verb_len);
+        if (cmd.verb == "REGISTER" && !cmd.arg.empty()) {
+            forwardLine("REGISTER " + std::string(cmd.arg), &conn);
+            answerRegister(conn, co_await conn.awaitReply());
+        } else {
+            dispatchLine(conn, line.text, line.verb_len);
+        }
+    }
+    while (true) {
+        FrameView f = co_await conn.readFrame();
+        if (f.frame->type == FRAME_HEARTBEAT) noteHeartbeat(conn, f.frame->handle);
+        else if (f.frame->type == FRAME_LEAVE) noteLeave(f.frame->handle);
+    }
+}
+
+bool handleWorker(Connection &conn, const char *data, size_t len) {
+    if (!conn.handler) conn.handler = serveWorker(conn);
+    bool ok;
+    if (conn.binary) {
+        ok = conn.decoder.feed(data, len, [&conn](const Frame &frame, const char *payload) {
+            conn.deliver(FrameView{&frame, payload});
+        });
+    } else {
+        ok = conn.framer.feed(data, len, [&conn](std::string_view line, size_t verb_len) {
+            conn.deliver(TextLine{line, verb_len});
+        });
+    }
+    return ok && !conn.handler.done();
+}
+
+int openListenSocket() {
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(options.port);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(sock, SOMAXCONN) < 0) {
+        std::cerr << "[ERROR] Cannot listen on port " << options.port << ": " << strerror(errno) << std::endl;
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+
+// ----------------------------------------------------
+// Main
+// ----------------------------------------------------
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--id" && i + 1 < argc) {
+            options.id = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            options.port = atoi(argv[++i]);
+        } else if (arg == "--upstream" && i + 1 < argc) {
+            std::string target = argv[++i];
+            size_t colon = target.rfind(':');
+            options.upstream_host = target.substr(0, colon);
+            if (colon != std::string::npos) options.upstream_port = atoi(target.c_str() + colon + 1);
+        } else if (arg == "--interval-ms" && i + 1 < argc) {
+            options.interval_ms = std::max(10, atoi(argv[++i]));
+        } else if (arg == "--backend" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (name == "epoll") options.backend = Backend::Epoll;
+            else if (name == "uring") options.backend = Backend::Uring;
+            else options.backend = Backend::Auto;
+        } else {
+            std::cerr << USAGE << std::endl;
+            return 1;
+        }
+    }
+
+    signal(SIGINT, signalHandler);
+    signal(SIGTERM, signalHandler);
+    signal(SIGPIPE, SIG_IGN);
+    raiseFdLimit();
+
+    int sock = openListenSocket();
+    if (sock < 0) return 1;
+    Backend backend = resolveBackend(options.backend);
+    logger.info("Relay " + options.id + " listening on port " + std::to_string(options.port) +
+                " (" + backendName(backend) + "), batching every " + std::to_string(options.interval_ms) + "ms");
+
+    std::unique_ptr<Reactor> reactor = makeReactor(backend, sock, handleWorker);
+    worker_reactor = reactor.get();
+    std::thread uplink(runUplink);
+    uplink.detach();
+    std::thread control(runControl);
+    control.detach();
+
+    reactor->run(shutdown_requested);
+    close(sock);
+    logger.info("Relay shut down.");
+    return 0;
+}
@@ -0,0 +1,94 @@
+// slab.cpp
+#include "slab.hpp"
+#include <algorithm>
+#include <atomic>
+#include <sys/mman.h>
+
+const size_t CHUNK_BYTES = 64 * 1024;
+const size_t HUGE_CHUNK_BYTES = 2 * 1024 * 1024;
+const size_t PAGE_BYTES = 4096;
+
+static std::atomic<bool> huge_pages{false};
+
+void SlabPool::setHugePages(bool enabled) { huge_pages = enabled; }
+bool SlabPool::hugePages() { return huge_pages; }
+
+SlabPool::SlabPool(size_t object_size) {
+    setObjectSize(object_size);
+}
+
+SlabPool::~SlabPool() {
+    for (auto &chunk : chunks) munmap(chunk.first, chunk.second);
+}
+
+void SlabPool::setObjectSize(size_t size) {
+    if (size == 0 || !chunks.empty()) return;
+    // Room for the free-list link, and keep objects 16-byte aligned
+    size = size < sizeof(FreeBlock) ? sizeof(FreeBlock) : size;
+    object_size = (size + 15) & ~(size_t)15;
+}
+
+void SlabPool::grow(size_t objects) {
+    bool huge = huge_pages;
+    // At least a chunk's worth of whole objects, rounded up to the page
+    // size: an object near the chunk size (a node table record block is
+    // ~57 KB) gets 60 KB rather than 64 KB of mostly unused address space
+    size_t unit = huge ? HUGE_CHUNK_BYTES : CHUNK_BYTES;
+    size_t page = huge ? HUGE_CHUNK_BYTES : PAGE_BYTES;
+    size_t wanted = std::max(objects, unit / object_size) * object_size;
+    size_t bytes = (wanted + page - 1) / page * page;
+
+    void *p = MAP_FAILED;
+    bool backed_huge = false;
+    if (huge) {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        backed_huge = p != MAP_FAILED;
+    }
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        if (huge) backed_huge = madvise(p, bytes, MADV_HUGEPAGE) == 0;
+    }
+    chunks.emplace_back(p, bytes);
+    if (backed_huge) huge_chunks++;
+
+    // Thread the new objects onto the free list in address order
+    size_t count = bytes / object_size;
+    char *base = (char *)p;
+    for (size_t i = count; i-- > 0;) {
+        FreeBlock *block = (FreeBlock *)(base + i * object_size);
+        block->next = free_list;
+        free_list = block;
+    }
+    capacity += count;
+}
+
+void *SlabPool::allocate() {
+    if (!free_list) grow();
+    FreeBlock *block = free_list;
+    free_list = block->next;
+    in_use++;
+    return block;
+}
+
+void SlabPool::reserve(size_t objects) {
+    size_t free = capacity - in_use;
+    if (objects > free) grow(objects - free);
+}
+
+void SlabPool::release(void *p) {
+    FreeBlock *block = (FreeBlock *)p;
+    block->next = free_list;
+    free_list = block;
+    in_use--;
+}
+
+SlabStats SlabPool::stats() const {
+    SlabStats s;
+    s.object_size = object_size;
+    s.in_use = in_use;
+    s.capacity = capacity;
+    s.chunks = chunks.size();
+    s.huge_chunks = huge_chunks;
+    return s;
+}
@@ -0,0 +1,86 @@
+#ifndef SLAB_HPP
+#define SLAB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+struct SlabStats {
+    size_t object_size = 0;
+    size_t in_use = 0;
+    size_t capacity = 0; // objects in all chunks
+    size_t chunks = 0;
+    size_t huge_chunks = 0; // chunks backed by explicit or transparent huge pages
+};
+
+// ----------------------------------------------------
+// Fixed-size object pool
+//
+// Objects are carved from large mmap'd chunks and recycled through an
+// intrusive free list, so records that come and go with worker reconnects
+// reuse the same memory instead of fragmenting the heap. Chunks are never
+// unmapped while the pool lives. A chunk holds as many whole objects as
+// fit in 64 KB (at least one), rounded up to the page size.
+//
+// With huge pages enabled (setHugePages), chunks are 2 MB and are first
+// requested with MAP_HUGETLB; if no huge pages are reserved the chunk is
+// mapped normally and madvise(MADV_HUGEPAGE) asks for transparent ones.
+//
+// Not thread-safe; each pool has a single owner or is guarded by its
+// owner's lock.
+// ----------------------------------------------------
+class SlabPool {
+public:
+    explicit SlabPool(size_t object_size = 0);
+    ~SlabPool();
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    // Object size can be fixed late, before the first allocation
+    void setObjectSize(size_t size);
+    size_t objectSize() const { return object_size; }
+
+    void *allocate();
+    void release(void *p);
+
+    // Maps room for `objects` more objects in one chunk if the free list
+    // is shorter, for a population known up front
+    void reserve(size_t objects);
+
+    template <typename T, typename... Args>
+    T *create(Args &&...args) {
+        return new (allocate()) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    void destroy(T *p) {
+        if (!p) return;
+        p->~T();
+        release(p);
+    }
+
+    SlabStats stats() const;
+
+    // Process-wide default for chunks mapped from now on
+    static void setHugePages(bool enabled);
+    static bool hugePages();
+
+private:
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    void grow(size_t objects = 1);
+
+    size_t object_size = 0;
+    FreeBlock *free_list = nullptr;
+    size_t in_use = 0;
+    size_t capacity = 0;
+    size_t huge_chunks = 0;
+    std::vector<std::pair<void *, size_t>> chunks;
+};
+
+#endif
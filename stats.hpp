@@ -0,0 +1,38 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Counter that many threads bump concurrently. Each thread increments its
+// own cache line and readers sum the stripes, so hot paths never bounce a
+// shared line between cores.
+class StripedCounter {
+public:
+    void add(uint64_t n = 1) {
+        slots[threadSlot()].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (const Slot &s : slots) sum += s.value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+private:
+    static const size_t STRIPES = 64;
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    static size_t threadSlot() {
+        static std::atomic<size_t> next{0};
+        thread_local size_t slot = next.fetch_add(1) % STRIPES;
+        return slot;
+    }
+
+    Slot slots[STRIPES];
+};
+
+#endif
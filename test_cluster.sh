@@ -11,7 +11,7 @@ echo "=== Cleaning old processes and logs ==="
 pkill -9 -f "./manager" 2>/dev/null
 pkill -9 -f "./worker" 2>/dev/null
 sleep 1
-rm -f cluster_state.json
+rm -f cluster_state.json cluster_state.journal cluster_state.tag
 rm -f $LOG_DIR/*.log
 rm -f manager.log worker.log
 
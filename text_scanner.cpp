@@ -0,0 +1,130 @@
+// text_scanner.cpp
+#include "text_scanner.hpp"
+#include <cstring>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+const uint32_t NO_SPACE = UINT32_MAX;
+
+struct ScanState {
+    uint32_t line_start = 0;
+    uint32_t space = NO_SPACE; // first space of the current line, once seen
+    size_t count = 0;
+};
+
+// Walks the newline and space bitmasks of the 64 bytes starting at base.
+// Returns false once the span array is full.
+inline bool processBlock(uint32_t base, uint64_t nl_mask, uint64_t sp_mask,
+                         ScanState &st, LineSpan *spans, size_t max_spans) {
+    while (true) {
+        if (st.space == NO_SPACE) {
+            uint32_t skip = st.line_start > base ? st.line_start - base : 0;
+            uint64_t m = skip >= 64 ? 0 : sp_mask & (~0ULL << skip);
+            if (m) st.space = base + __builtin_ctzll(m);
+        }
+        if (!nl_mask) return true;
+
+        uint32_t pos = base + __builtin_ctzll(nl_mask);
+        nl_mask &= nl_mask - 1;
+        spans[st.count++] = {st.line_start, pos, st.space < pos ? st.space : pos};
+        st.line_start = pos + 1;
+        st.space = NO_SPACE;
+        if (st.count == max_spans) return false;
+    }
+}
+
+// Masks for a short tail, built one byte at a time
+inline bool processTail(const char *data, uint32_t base, size_t n,
+                        ScanState &st, LineSpan *spans, size_t max_spans) {
+    uint64_t nl_mask = 0, sp_mask = 0;
+    for (size_t j = 0; j < n; j++) {
+        nl_mask |= (uint64_t)(data[base + j] == '\n') << j;
+        sp_mask |= (uint64_t)(data[base + j] == ' ') << j;
+    }
+    return processBlock(base, nl_mask, sp_mask, st, spans, max_spans);
+}
+
+} // namespace
+
+size_t scanLinesScalar(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed) {
+    size_t count = 0;
+    const char *p = data;
+    const char *end = data + len;
+    while (count < max_spans && p < end) {
+        const char *nl = (const char *)memchr(p, '\n', end - p);
+        if (!nl) break;
+        const char *sp = (const char *)memchr(p, ' ', nl - p);
+        spans[count++] = {(uint32_t)(p - data), (uint32_t)(nl - data),
+                          (uint32_t)((sp ? sp : nl) - data)};
+        p = nl + 1;
+    }
+    consumed = p - data;
+    return count;
+}
+
+#if defined(__x86_64__)
+// SSE2 is part of the x86-64 baseline, so this kernel needs no check
+size_t scanLinesSse2(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i sp = _mm_set1_epi8(' ');
+    ScanState st;
+    size_t i = 0;
+    bool room = true;
+    for (; room && i + 64 <= len; i += 64) {
+        uint64_t nl_mask = 0, sp_mask = 0;
+        for (int k = 0; k < 4; k++) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(data + i + 16 * k));
+            nl_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)) << (16 * k);
+            sp_mask |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, sp)) << (16 * k);
+        }
+        room = processBlock(i, nl_mask, sp_mask, st, spans, max_spans);
+    }
+    if (room && i < len) processTail(data, i, len - i, st, spans, max_spans);
+    consumed = st.line_start;
+    return st.count;
+}
+
+__attribute__((target("avx2")))
+size_t scanLinesAvx2(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    const __m256i sp = _mm256_set1_epi8(' ');
+    ScanState st;
+    size_t i = 0;
+    bool room = true;
+    for (; room && i + 64 <= len; i += 64) {
+        __m256i lo = _mm256_loadu_si256((const __m256i *)(data + i));
+        __m256i hi = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        uint64_t nl_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, nl)) |
+                           (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, nl)) << 32;
+        uint64_t sp_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, sp)) |
+                           (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, sp)) << 32;
+        room = processBlock(i, nl_mask, sp_mask, st, spans, max_spans);
+    }
+    if (room && i < len) processTail(data, i, len - i, st, spans, max_spans);
+    consumed = st.line_start;
+    return st.count;
+}
+#endif
+
+static LineScanFn pickLineScanner() {
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return scanLinesAvx2;
+    return scanLinesSse2;
+#else
+    return scanLinesScalar;
+#endif
+}
+
+const LineScanFn scanLines = pickLineScanner();
+
+const char *lineScannerName(LineScanFn fn) {
+#if defined(__x86_64__)
+    if (fn == scanLinesAvx2) return "avx2";
+    if (fn == scanLinesSse2) return "sse2";
+#endif
+    return "scalar";
+}
@@ -0,0 +1,43 @@
+#ifndef TEXT_SCANNER_HPP
+#define TEXT_SCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// ----------------------------------------------------
+// Vectorised line and verb scanner for the text protocol
+//
+// One pass over a receive buffer finds every '\n' and, for each line, the
+// first ' ' that separates the verb from its argument. The SIMD kernels
+// compare 64 bytes at a time against both characters and walk the
+// resulting bitmasks, so the cost per line is a couple of bit operations
+// instead of a memchr plus a prefix search per command.
+//
+// The best kernel for the running CPU is picked once at startup.
+// ----------------------------------------------------
+
+// Offsets into the scanned buffer. verb_end is the first space in the line,
+// or end when there is none.
+struct LineSpan {
+    uint32_t begin;
+    uint32_t end; // the '\n'
+    uint32_t verb_end;
+};
+
+// Fills up to max_spans spans for the complete lines in data and returns how
+// many it found. `consumed` is set to the offset just past the last '\n'
+// reported; anything after it is a partial line (or did not fit in spans).
+using LineScanFn = size_t (*)(const char *data, size_t len, LineSpan *spans,
+                              size_t max_spans, size_t &consumed);
+
+size_t scanLinesScalar(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed);
+#if defined(__x86_64__)
+size_t scanLinesSse2(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed);
+size_t scanLinesAvx2(const char *data, size_t len, LineSpan *spans, size_t max_spans, size_t &consumed);
+#endif
+
+// The kernel picked for this CPU, and its name for logs and benchmarks
+extern const LineScanFn scanLines;
+const char *lineScannerName(LineScanFn fn);
+
+#endif
@@ -0,0 +1,84 @@
+// udp_listener.cpp
+#include "udp_listener.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+extern Logger logger;
+
+const int RECV_TIMEOUT_MS = 1000; // how often the loop re-checks the stop flag
+const int RECV_BUFFER_BYTES = 8 * 1024 * 1024; // absorb bursts from large clusters
+
+UdpListener::UdpListener(int port, DatagramHandler on_datagram)
+    : on_datagram(std::move(on_datagram)) {
+    sock = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (sock < 0) return;
+
+    int opt = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    int rcvbuf = RECV_BUFFER_BYTES;
+    setsockopt(sock, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    timeval tv{};
+    tv.tv_sec = RECV_TIMEOUT_MS / 1000;
+    tv.tv_usec = (RECV_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        logger.warn(std::string("Cannot bind UDP port ") + std::to_string(port) + ": " + strerror(errno));
+        close(sock);
+        sock = -1;
+    }
+}
+
+UdpListener::~UdpListener() {
+    if (sock >= 0) close(sock);
+}
+
+// ----------------------------------------------------
+// Receive loop: one recvmmsg() drains up to BATCH datagrams
+// ----------------------------------------------------
+void UdpListener::run(const volatile sig_atomic_t &stop) {
+    if (sock < 0) return;
+
+    char buffers[BATCH][MAX_DATAGRAM];
+    mmsghdr msgs[BATCH];
+    iovec iovecs[BATCH];
+    sockaddr_in senders[BATCH];
+
+    while (!stop) {
+        for (unsigned i = 0; i < BATCH; i++) {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = MAX_DATAGRAM;
+            msgs[i].msg_hdr = msghdr{};
+            msgs[i].msg_hdr.msg_iov = &iovecs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &senders[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(senders[i]);
+        }
+
+        // Block for the first datagram, then take whatever else is queued
+        int n = recvmmsg(sock, msgs, BATCH, MSG_WAITFORONE, nullptr);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) continue;
+            logger.warn(std::string("recvmmsg failed: ") + strerror(errno));
+            break;
+        }
+        LivenessClock::tick();
+        for (int i = 0; i < n; i++) {
+            std::string reply = on_datagram(std::string_view(buffers[i], msgs[i].msg_len));
+            if (!reply.empty()) {
+                sendto(sock, reply.data(), reply.size(), MSG_DONTWAIT,
+                       (struct sockaddr*)&senders[i], msgs[i].msg_hdr.msg_namelen);
+            }
+        }
+    }
+}
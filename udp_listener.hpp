@@ -0,0 +1,30 @@
+#ifndef UDP_LISTENER_HPP
+#define UDP_LISTENER_HPP
+
+#include <csignal>
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Connectionless heartbeat channel. Datagrams are drained in batches of up
+// to BATCH per recvmmsg() call and handed to the handler one by one. A
+// non-empty string returned by the handler is sent back to the sender.
+class UdpListener {
+public:
+    static const unsigned BATCH = 64;
+    static const size_t MAX_DATAGRAM = 512;
+
+    using DatagramHandler = std::function<std::string(std::string_view payload)>;
+
+    UdpListener(int port, DatagramHandler on_datagram);
+    ~UdpListener();
+
+    bool ok() const { return sock >= 0; }
+    void run(const volatile sig_atomic_t &stop);
+
+private:
+    int sock = -1;
+    DatagramHandler on_datagram;
+};
+
+#endif
@@ -0,0 +1,360 @@
+// uring_reactor.cpp
+#include "uring_reactor.hpp"
+#include "clock.hpp"
+#include "logger.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+extern Logger logger;
+
+const unsigned SQ_ENTRIES = 4096;
+const unsigned CQ_ENTRIES = 16384;
+const unsigned BUF_COUNT = 2048;      // power of two, at most 32768
+const unsigned BUF_SIZE = 2048;
+const unsigned short BUF_GROUP = 0;
+const long WAIT_TIMEOUT_MS = 1000; // how often the loop re-checks the stop flag
+
+enum UringOp : uint64_t { OP_ACCEPT = 1, OP_RECV = 2, OP_WAKE = 3, OP_WRITABLE = 4 };
+
+static uint64_t packUserData(UringOp op, int fd) {
+    return (uint64_t(op) << 32) | uint32_t(fd);
+}
+
+static int sysSetup(unsigned entries, io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+                    const void *arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sysRegister(int fd, unsigned opcode, const void *arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// ----------------------------------------------------
+// Runtime capability probe
+// ----------------------------------------------------
+bool UringReactor::supported() {
+    // Multishot recv landed in 6.0; older kernels reject it with EINVAL
+    // only at completion time, so gate on the release instead.
+    utsname u{};
+    int major = 0, minor = 0;
+    if (uname(&u) != 0 || sscanf(u.release, "%d.%d", &major, &minor) != 2) return false;
+    if (major < 6) return false;
+
+    io_uring_params p{};
+    int fd = sysSetup(8, &p);
+    if (fd < 0) return false;
+    bool ok = (p.features & IORING_FEAT_EXT_ARG) && (p.features & IORING_FEAT_SINGLE_MMAP);
+
+    // Provided buffer rings (5.19+)
+    if (ok) {
+        size_t size = sysconf(_SC_PAGESIZE);
+        void *mem = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mem == MAP_FAILED) {
+            ok = false;
+        } else {
+            io_uring_buf_reg reg{};
+            reg.ring_addr = (uint64_t)mem;
+            reg.ring_entries = 1;
+            reg.bgid = BUF_GROUP;
+            ok = sysRegister(fd, IORING_REGISTER_PBUF_RING, &reg, 1) == 0;
+            munmap(mem, size);
+        }
+    }
+    close(fd);
+    return ok;
+}
+
+// ----------------------------------------------------
+// Setup and teardown
+// ----------------------------------------------------
+UringReactor::UringReactor(int listen_fd, DataHandler on_data)
+    : Reactor(std::move(on_data)), listen_fd(listen_fd) {
+    if (!setupRing() || !setupBuffers()) {
+        logger.warn(std::string("io_uring setup failed: ") + strerror(errno));
+        if (ring_fd >= 0) close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+UringReactor::~UringReactor() {
+    if (ring_fd >= 0) close(ring_fd); // cancels everything still in flight
+    if (buf_base) munmap(buf_base, (size_t)BUF_COUNT * BUF_SIZE);
+    if (buf_ring) munmap(buf_ring, buf_ring_size);
+    if (sqes) munmap(sqes, sqes_size);
+    if (ring_ptr) munmap(ring_ptr, ring_size);
+}
+
+bool UringReactor::setupRing() {
+    // Prefer deferred task running (6.1+), then cooperative task running,
+    // then plain rings.
+    const unsigned flag_sets[] = {
+        IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN,
+        IORING_SETUP_COOP_TASKRUN,
+        0,
+    };
+    io_uring_params p{};
+    for (unsigned flags : flag_sets) {
+        p = io_uring_params{};
+        p.flags = flags | IORING_SETUP_CQSIZE;
+        p.cq_entries = CQ_ENTRIES;
+        ring_fd = sysSetup(SQ_ENTRIES, &p);
+        if (ring_fd >= 0 || errno != EINVAL) break;
+    }
+    if (ring_fd < 0) return false;
+
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring_ptr = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    ring_fd, IORING_OFF_SQ_RING);
+    if (ring_ptr == MAP_FAILED) {
+        ring_ptr = nullptr;
+        return false;
+    }
+    sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+    void *sqe_ptr = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring_fd, IORING_OFF_SQES);
+    if (sqe_ptr == MAP_FAILED) return false;
+    sqes = (io_uring_sqe *)sqe_ptr;
+
+    char *base = (char *)ring_ptr;
+    sq_head = (unsigned *)(base + p.sq_off.head);
+    sq_tail = (unsigned *)(base + p.sq_off.tail);
+    sq_mask = *(unsigned *)(base + p.sq_off.ring_mask);
+    sq_entries = p.sq_entries;
+    sq_array = (unsigned *)(base + p.sq_off.array);
+    cq_head = (unsigned *)(base + p.cq_off.head);
+    cq_tail = (unsigned *)(base + p.cq_off.tail);
+    cq_mask = *(unsigned *)(base + p.cq_off.ring_mask);
+    cqes = (io_uring_cqe *)(base + p.cq_off.cqes);
+
+    // SQ slots map 1:1 onto SQEs, so the indirection array never changes
+    for (unsigned i = 0; i < sq_entries; i++) sq_array[i] = i;
+    sq_local_tail = *sq_tail;
+    return true;
+}
+
+bool UringReactor::setupBuffers() {
+    buf_ring_size = BUF_COUNT * sizeof(io_uring_buf);
+    void *ring_mem = mmap(nullptr, buf_ring_size, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring_mem == MAP_FAILED) return false;
+    buf_ring = (io_uring_buf_ring *)ring_mem;
+
+    void *data = mmap(nullptr, (size_t)BUF_COUNT * BUF_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) return false;
+    buf_base = (char *)data;
+
+    io_uring_buf_reg reg{};
+    reg.ring_addr = (uint64_t)buf_ring;
+    reg.ring_entries = BUF_COUNT;
+    reg.bgid = BUF_GROUP;
+    if (sysRegister(ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) return false;
+
+    for (unsigned i = 0; i < BUF_COUNT; i++) recycleBuffer((unsigned short)i);
+    __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+    return true;
+}
+
+// ----------------------------------------------------
+// Submission helpers
+// ----------------------------------------------------
+io_uring_sqe *UringReactor::nextSqe() {
+    // Flush to the kernel if the submission ring is full
+    while (sq_local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries) {
+        if (enter(0) < 0 && errno != EAGAIN && errno != EBUSY && errno != EINTR) return nullptr;
+    }
+    io_uring_sqe *sqe = &sqes[sq_local_tail & sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sq_local_tail++;
+    unsubmitted++;
+    return sqe;
+}
+
+// Publishes queued SQEs and optionally waits for completions, bounded by
+// WAIT_TIMEOUT_MS so the caller can notice shutdown.
+int UringReactor::enter(unsigned wait_nr) {
+    __atomic_store_n(sq_tail, sq_local_tail, __ATOMIC_RELEASE);
+
+    __kernel_timespec ts{};
+    ts.tv_sec = WAIT_TIMEOUT_MS / 1000;
+    ts.tv_nsec = (WAIT_TIMEOUT_MS % 1000) * 1000000L;
+    io_uring_getevents_arg arg{};
+    arg.ts = (uint64_t)&ts;
+
+    unsigned flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+    int ret = sysEnter(ring_fd, unsubmitted, wait_nr, flags, &arg, sizeof(arg));
+    if (ret >= 0) unsubmitted -= (unsigned)ret;
+    return ret;
+}
+
+void UringReactor::armAccept() {
+    io_uring_sqe *sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = packUserData(OP_ACCEPT, listen_fd);
+}
+
+void UringReactor::armRecv(int fd) {
+    io_uring_sqe *sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP;
+    sqe->user_data = packUserData(OP_RECV, fd);
+}
+
+// Multishot poll on the wakeup eventfd: one completion per post() burst
+void UringReactor::armWake() {
+    io_uring_sqe *sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = wakeFd();
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = packUserData(OP_WAKE, wakeFd());
+}
+
+// One-shot: completes once the socket has room for queued output
+void UringReactor::armWritable(int fd) {
+    io_uring_sqe *sqe = nextSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLOUT;
+    sqe->user_data = packUserData(OP_WRITABLE, fd);
+}
+
+void UringReactor::settle(Connection &conn) {
+    if (conn.write_failed) {
+        // Closed the same way as a failed read: the recv ends with EOF
+        if (!closing[conn.fd]) {
+            closing[conn.fd] = true;
+            shutdown(conn.fd, SHUT_RDWR);
+        }
+        return;
+    }
+    if (conn.unsent && !conn.write_armed) {
+        armWritable(conn.fd);
+        conn.write_armed = true;
+    }
+}
+
+// Hands a buffer back to the kernel. The new tail is published once per
+// batch of completions.
+void UringReactor::recycleBuffer(unsigned short bid) {
+    // Index the entries directly: in C++ the header's flex-array wrapper
+    // shifts `bufs` by the size of an empty struct.
+    io_uring_buf &buf = ((io_uring_buf *)buf_ring)[buf_tail & (BUF_COUNT - 1)];
+    buf.addr = (uint64_t)(buf_base + (size_t)bid * BUF_SIZE);
+    buf.len = BUF_SIZE;
+    buf.bid = bid;
+    buf_tail++;
+}
+
+// ----------------------------------------------------
+// Completion handling
+// ----------------------------------------------------
+void UringReactor::handleCompletion(const io_uring_cqe &cqe) {
+    UringOp op = (UringOp)(cqe.user_data >> 32);
+    int fd = (int)(uint32_t)cqe.user_data;
+    bool more = cqe.flags & IORING_CQE_F_MORE;
+
+    if (op == OP_ACCEPT) {
+        if (cqe.res >= 0) {
+            openConnection(cqe.res);
+            if ((size_t)cqe.res >= closing.size()) closing.resize(cqe.res + 1);
+            closing[cqe.res] = false;
+            armRecv(cqe.res);
+        } else if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+            // Turn the pending connection away rather than retry it forever
+            if (shedConnection(listen_fd)) logger.warn("Out of file descriptors: turned a connection away");
+        } else if (cqe.res != -EINTR && cqe.res != -ECONNABORTED) {
+            logger.warn(std::string("io_uring accept failed: ") + strerror(-cqe.res));
+            if (cqe.res == -EINVAL) accept_failed = true;
+        }
+        if (!more && !accept_failed) armAccept();
+        return;
+    }
+    if (op == OP_WAKE) {
+        runPosted();
+        if (!more) armWake();
+        return;
+    }
+
+    Connection *conn = findConnection(fd);
+    if (op == OP_WRITABLE) {
+        // May be left over from an earlier connection on this fd; flushing
+        // is harmless either way
+        if (!conn || closing[fd]) return;
+        conn->write_armed = false;
+        conn->flushUnsent();
+        settle(*conn);
+        return;
+    }
+    if (cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+        unsigned short bid = cqe.flags >> IORING_CQE_BUFFER_SHIFT;
+        if (conn && !closing[fd]) {
+            if (on_data(*conn, buf_base + (size_t)bid * BUF_SIZE, cqe.res)) {
+                settle(*conn);
+            } else {
+                // Wake the multishot recv with EOF; the fd is released once it ends
+                closing[fd] = true;
+                shutdown(fd, SHUT_RDWR);
+            }
+        }
+        recycleBuffer(bid);
+    }
+
+    if (!more && conn) {
+        // The multishot recv ended: either EOF/error, or it ran out of
+        // buffers and needs re-arming now that we have recycled some.
+        if (closing[fd] || cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS)) {
+            dropConnection(fd);
+        } else {
+            armRecv(fd);
+        }
+    }
+}
+
+void UringReactor::run(const volatile sig_atomic_t &stop) {
+    if (ring_fd < 0) return;
+    armAccept();
+    armWake();
+
+    while (!stop && !accept_failed) {
+        int ret = enter(1);
+        if (ret < 0 && errno != EINTR && errno != ETIME && errno != EAGAIN && errno != EBUSY) {
+            logger.warn(std::string("io_uring_enter failed: ") + strerror(errno));
+            break;
+        }
+        LivenessClock::tick();
+
+        // Reap every available completion, then publish the new CQ head
+        // and any recycled buffers in one go.
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            handleCompletion(cqes[head & cq_mask]);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+        __atomic_store_n(&buf_ring->tail, buf_tail, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef URING_REACTOR_HPP
+#define URING_REACTOR_HPP
+
+#include "reactor.hpp"
+#include <linux/io_uring.h>
+
+// io_uring backend. One multishot accept keeps producing new connections and
+// every connection has one multishot recv that picks its buffer from a
+// provided buffer ring, so in steady state a single io_uring_enter() both
+// submits re-arms and reaps a whole batch of completions.
+class UringReactor : public Reactor {
+public:
+    UringReactor(int listen_fd, DataHandler on_data);
+    ~UringReactor() override;
+
+    void run(const volatile sig_atomic_t &stop) override;
+
+    // True if the kernel supports multishot accept/recv with provided
+    // buffer rings and timed waits.
+    static bool supported();
+
+private:
+    bool setupRing();
+    bool setupBuffers();
+    io_uring_sqe *nextSqe();
+    int enter(unsigned wait_nr);
+    void armAccept();
+    void armRecv(int fd);
+    void armWake();
+    void armWritable(int fd);
+    void settle(Connection &conn) override;
+    void recycleBuffer(unsigned short bid);
+    void handleCompletion(const io_uring_cqe &cqe);
+
+    int listen_fd;
+    int ring_fd = -1;
+    bool accept_failed = false;
+
+    // Submission and completion rings (single mmap)
+    void *ring_ptr = nullptr;
+    size_t ring_size = 0;
+    io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+    unsigned *sq_head = nullptr, *sq_tail = nullptr, *sq_array = nullptr;
+    unsigned sq_mask = 0, sq_entries = 0;
+    unsigned sq_local_tail = 0, unsubmitted = 0;
+    unsigned *cq_head = nullptr, *cq_tail = nullptr;
+    unsigned cq_mask = 0;
+    io_uring_cqe *cqes = nullptr;
+
+    // Provided buffer ring for multishot recv
+    io_uring_buf_ring *buf_ring = nullptr;
+    size_t buf_ring_size = 0;
+    char *buf_base = nullptr;
+    unsigned short buf_tail = 0;
+
+    // Connections we asked to close; their fd is released once the
+    // outstanding multishot recv reports its final completion.
+    std::vector<bool> closing;
+};
+
+#endif
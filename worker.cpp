@@ -5,16 +5,36 @@
 #include <thread>
 #include <chrono>
 #include <csignal>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <random>
 #include <netinet/tcp.h> 
+#include <sys/un.h>
+#include <poll.h>
 #include "logger.hpp"
+#include "protocol.hpp"
+#include "heartbeat_board.hpp"
 
 const char* MANAGER_IP = "127.0.0.1";
-const int PORT = 5050;
-const int HEARTBEAT_INTERVAL = 2; // seconds
+int port = 5050; // --port points workers at a relay instead
+int heartbeat_interval_ms = 2000; // --interval-ms, for managers run with a short --timeout-ms
 const int RETRY_INTERVAL = 3;     // seconds
+const int NEGOTIATE_TIMEOUT_MS = 1000; // old managers never answer REGISTER
 
 Logger logger("worker.log");
 
+// Set by SIGINT/SIGTERM: the heartbeat loop stops and tells the manager
+// the node is leaving rather than letting it time out
+volatile sig_atomic_t leaving = 0;
+
+void onShutdown(int) { leaving = 1; }
+
+// Set by --unix: reach a same-host manager over its AF_UNIX socket instead
+// of loopback TCP. UDP heartbeats are unaffected.
+std::string unix_path;
+
 // ------------------------------------------------------------------
 // Helper to send a message safely
 // ------------------------------------------------------------------
@@ -22,64 +42,283 @@ void sendMessage(int sock, const std::string &msg) {
     send(sock, msg.c_str(), msg.length(), 0);
 }
 
+// ------------------------------------------------------------------
+// One connection attempt over TCP, or the unix socket if configured
+// ------------------------------------------------------------------
+int connectOnce(sockaddr_in &serv_addr, int &sock) {
+    if (unix_path.empty()) {
+        sock = socket(AF_INET, SOCK_STREAM, 0);
+        return connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+    }
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    unix_path.copy(addr.sun_path, sizeof(addr.sun_path) - 1);
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    return connect(sock, (struct sockaddr*)&addr, sizeof(addr));
+}
+
 // ------------------------------------------------------------------
 // Try connecting repeatedly until manager is available
 // ------------------------------------------------------------------
 int connectWithRetry(sockaddr_in &serv_addr) {
     int sock;
     while (true) {
-        sock = socket(AF_INET, SOCK_STREAM, 0);
-        if (connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr)) == 0) {
+        if (connectOnce(serv_addr, sock) == 0) {
             return sock; // success
         }
         std::cerr << "[WARN] Manager unavailable. Retrying in "
                   << RETRY_INTERVAL << "s...\n";
         std::this_thread::sleep_for(std::chrono::seconds(RETRY_INTERVAL));
         close(sock);
+        if (leaving) exit(0); // never got in, so nothing to leave
+    }
+}
+
+// ------------------------------------------------------------------
+// Reads until a whole reply line is in `line` (without the '\n'),
+// waiting at most timeout_ms. A partial line is kept for the next call.
+// ------------------------------------------------------------------
+bool readLine(int sock, std::string &line, int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while (true) {
+        int remaining = (int)std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now()).count();
+        pollfd pfd{sock, POLLIN, 0};
+        if (poll(&pfd, 1, std::max(remaining, 0)) <= 0) return false;
+
+        char c;
+        if (recv(sock, &c, 1, 0) <= 0) return false;
+        if (c == '\n') return true;
+        line += c;
+    }
+}
+
+// What the manager told us at REGISTER time
+struct Session {
+    uint32_t handle = NO_HANDLE; // stays NO_HANDLE with old managers
+    bool binary = false;
+};
+
+// ------------------------------------------------------------------
+// REGISTER and optionally offer binary frames. A current manager answers
+// "OK <handle>" (then "PROTO <v>" if offered); an old one answers
+// nothing, which leaves us on ID-carrying text heartbeats. A manager
+// absorbing a reconnect storm may answer "RETRY <ms>" instead, and one
+// that can never take this node "REJECTED <reason>".
+// ------------------------------------------------------------------
+Session registerNode(int sock, const std::string &node_id, bool offer_binary) {
+    static std::mt19937 rng(std::random_device{}());
+    Session session;
+    std::string offer = "PROTO " + std::to_string(PROTOCOL_VERSION);
+    while (true) {
+        sendMessage(sock, "REGISTER " + node_id + "\n");
+        if (offer_binary) sendMessage(sock, offer + "\n");
+
+        int retry_ms = 0;
+        std::string line;
+        while (readLine(sock, line, NEGOTIATE_TIMEOUT_MS)) {
+            if (line.rfind("OK ", 0) == 0) session.handle = strtoul(line.c_str() + 3, nullptr, 10);
+            else if (line == offer) session.binary = true;
+            else if (line.rfind("RETRY ", 0) == 0) retry_ms = std::max(1, atoi(line.c_str() + 6));
+            else if (line.rfind("REJECTED ", 0) == 0) {
+                std::cerr << "[ERROR] Manager rejected " << node_id << ": " << line.substr(9) << "\n";
+                exit(1);
+            }
+            bool done = session.binary || (!offer_binary && session.handle != NO_HANDLE) || retry_ms > 0;
+            line.clear();
+            if (done) break;
+        }
+        if (retry_ms == 0 || leaving) break;
+
+        // Jitter so workers turned away together do not come back together
+        std::this_thread::sleep_for(std::chrono::milliseconds(retry_ms + rng() % (retry_ms + 1)));
     }
+    session.binary = session.binary && session.handle != NO_HANDLE;
+
+    logger.info(std::string("Heartbeat protocol: ") + (session.binary ? "binary" : "text") +
+                (session.handle != NO_HANDLE ? ", handle " + std::to_string(session.handle) : ""));
+    return session;
 }
 
+// Text heartbeat: by handle when we have one, by ID for old managers
+std::string heartbeatLine(const std::string &node_id, const Session &session) {
+    if (session.handle != NO_HANDLE) return "HB " + std::to_string(session.handle) + "\n";
+    return "HEARTBEAT " + node_id + "\n";
+}
+
+uint64_t monotonicNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ------------------------------------------------------------------
+// REGISTER over TCP, then drop the connection (UDP mode)
+// ------------------------------------------------------------------
+Session registerOverTcp(sockaddr_in &serv_addr, const std::string &node_id) {
+    int sock = connectWithRetry(serv_addr);
+    Session session = registerNode(sock, node_id, false);
+    close(sock);
+    logger.info("Registered " + node_id + " over TCP");
+    return session;
+}
+
+// ------------------------------------------------------------------
+// UDP mode: heartbeats are datagrams, so the manager keeps no
+// per-connection state for this node. TCP is only used to register.
+// ------------------------------------------------------------------
+int runUdpWorker(sockaddr_in &serv_addr, const std::string &node_id) {
+    Session session = registerOverTcp(serv_addr, node_id);
+
+    // A connected UDP socket reports ICMP port-unreachable as ECONNREFUSED,
+    // which is how we notice the manager has gone away.
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    connect(sock, (struct sockaddr*)&serv_addr, sizeof(serv_addr));
+
+    while (!leaving) {
+        bool reregister = false;
+        std::string msg = heartbeatLine(node_id, session);
+        if (send(sock, msg.c_str(), msg.length(), 0) < 0) {
+            logger.warn("Manager unreachable over UDP. Re-registering...");
+            reregister = true;
+        } else {
+            logger.info("Heartbeat sent from " + node_id);
+        }
+
+        // The manager answers unknown nodes and stale handles
+        char reply[512];
+        ssize_t n;
+        while ((n = recv(sock, reply, sizeof(reply), MSG_DONTWAIT)) != 0) {
+            if (n < 0) {
+                if (errno == ECONNREFUSED) reregister = true;
+                if (errno != EINTR && errno != ECONNREFUSED) break;
+                continue;
+            }
+            if (std::string(reply, n).rfind("REREGISTER", 0) == 0) reregister = true;
+        }
+
+        if (reregister) session = registerOverTcp(serv_addr, node_id);
+        std::this_thread::sleep_for(std::chrono::milliseconds(heartbeat_interval_ms));
+    }
+
+    if (session.handle != NO_HANDLE) sendMessage(sock, "LEAVE " + std::to_string(session.handle) + "\n");
+    logger.info(node_id + " leaving the cluster");
+    close(sock);
+    return 0;
+}
+
+// ------------------------------------------------------------------
+// Shared-memory mode: no sockets at all. Claim a slot on the manager's
+// heartbeat board and store a timestamp into it every interval.
+// ------------------------------------------------------------------
+int runShmWorker(const std::string &shm_name, const std::string &node_id) {
+    std::unique_ptr<HeartbeatBoard> board;
+    while (true) {
+        board.reset(new HeartbeatBoard(shm_name));
+        if (board->ok()) break;
+        if (leaving) return 0;
+        std::cerr << "[WARN] Heartbeat board " << shm_name << " unavailable. Retrying in "
+                  << RETRY_INTERVAL << "s...\n";
+        std::this_thread::sleep_for(std::chrono::seconds(RETRY_INTERVAL));
+    }
+
+    BoardSlot *slot = board->claim(node_id);
+    if (!slot) {
+        std::cerr << "[ERROR] No board slot for " << node_id
+                  << " (board full or ID longer than " << HeartbeatBoard::MAX_ID << " chars)\n";
+        return 1;
+    }
+    logger.info("Claimed heartbeat board slot for " + node_id);
+
+    // The slot simply stops beating; it has no handle to leave with
+    while (!leaving) {
+        HeartbeatBoard::beat(slot, monotonicNs());
+        std::this_thread::sleep_for(std::chrono::milliseconds(heartbeat_interval_ms));
+    }
+    return 0;
+}
 
 // ------------------------------------------------------------------
 // Main
 // ------------------------------------------------------------------
 int main(int argc, char* argv[]) {
     signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, onShutdown);
+    signal(SIGTERM, onShutdown);
 
     if (argc < 2) {
-        std::cerr << "Usage: ./worker <node_id>\n";
+        std::cerr << "Usage: ./worker <node_id> [--udp] [--text] [--unix PATH] [--shm NAME] [--port N] [--interval-ms N]\n";
         return 1;
     }
     std::string node_id = argv[1];
+    bool use_udp = false;
+    std::string shm_name;
+    bool offer_binary = true; // --text keeps the legacy line protocol
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--udp") use_udp = true;
+        else if (arg == "--text") offer_binary = false;
+        else if (arg == "--unix" && i + 1 < argc) unix_path = argv[++i];
+        else if (arg == "--shm" && i + 1 < argc) shm_name = argv[++i];
+        else if (arg == "--port" && i + 1 < argc) port = atoi(argv[++i]);
+        else if (arg == "--interval-ms" && i + 1 < argc) heartbeat_interval_ms = std::max(1, atoi(argv[++i]));
+    }
 
     sockaddr_in serv_addr{};
     serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(PORT);
+    serv_addr.sin_port = htons(port);
     inet_pton(AF_INET, MANAGER_IP, &serv_addr.sin_addr);
 
+    if (!shm_name.empty()) return runShmWorker(shm_name, node_id);
+    if (use_udp) return runUdpWorker(serv_addr, node_id);
+
     int sock = connectWithRetry(serv_addr);
     // enableKeepAlive(sock);  // ← REMOVE THIS
     logger.info("Connected to manager. Node ID: " + node_id);
-    sendMessage(sock, "REGISTER " + node_id + "\n");
+    Session session = registerNode(sock, node_id, offer_binary);
+    uint64_t seq = 0;
+    std::string reply;
 
-    while (true) {
-        std::string msg = "HEARTBEAT " + node_id + "\n";
-        ssize_t result = send(sock, msg.c_str(), msg.length(), 0);
+    while (!leaving) {
+        ssize_t result;
+        if (session.binary) {
+            Frame frame = makeFrame(FRAME_HEARTBEAT, session.handle, ++seq, monotonicNs());
+            result = send(sock, &frame, sizeof(frame), 0);
+        } else {
+            std::string msg = heartbeatLine(node_id, session);
+            result = send(sock, msg.c_str(), msg.length(), 0);
+        }
+
+        // A stale handle (e.g. the manager restarted) gets a REREGISTER
+        bool reregister = false;
+        while (readLine(sock, reply, 0)) {
+            if (reply.rfind("REREGISTER", 0) == 0) reregister = true;
+            reply.clear();
+        }
 
-        if (result <= 0) {
-            logger.warn("Lost connection to manager. Reconnecting...");
+        if (result <= 0 || reregister) {
+            if (result <= 0) logger.warn("Lost connection to manager. Reconnecting...");
+            else logger.warn("Manager asked us to re-register. Reconnecting...");
             close(sock);
             sock = connectWithRetry(serv_addr);
             // enableKeepAlive(sock);  // ← REMOVE THIS TOO
             logger.info("Reconnected to manager. Re-registering " + node_id);
-            sendMessage(sock, "REGISTER " + node_id + "\n");
+            session = registerNode(sock, node_id, offer_binary);
+            reply.clear();
         } else {
             logger.info("Heartbeat sent from " + node_id);
         }
 
-        std::this_thread::sleep_for(std::chrono::seconds(HEARTBEAT_INTERVAL));
+        std::this_thread::sleep_for(std::chrono::milliseconds(heartbeat_interval_ms));
     }
 
+    // Old managers ignore both forms and fail the node as before
+    if (session.binary) {
+        Frame frame = makeFrame(FRAME_LEAVE, session.handle, ++seq, monotonicNs());
+        send(sock, &frame, sizeof(frame), 0);
+    } else if (session.handle != NO_HANDLE) {
+        sendMessage(sock, "LEAVE " + std::to_string(session.handle) + "\n");
+    }
+    logger.info(node_id + " leaving the cluster");
     close(sock);
     return 0;
 }
\ No newline at end of file